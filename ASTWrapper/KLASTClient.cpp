@@ -65,6 +65,11 @@ void KLASTClient::onFileParsed(const KLFile * file)
 
 }
 
+void KLASTClient::onFilesChanged(const std::vector<const KLFile*> & files)
+{
+
+}
+
 void KLASTClient::onASTChanged()
 {
 
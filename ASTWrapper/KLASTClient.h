@@ -33,6 +33,8 @@ namespace FabricServices
       virtual void onExtensionParsed(const KLExtension * extension);
       virtual void onFileLoaded(const KLFile * file);
       virtual void onFileParsed(const KLFile * file);
+      // files which were changed on disk and have been reparsed
+      virtual void onFilesChanged(const std::vector<const KLFile*> & files);
       virtual void onASTChanged();
 
     private:
@@ -9,6 +9,9 @@
 #include <FTL/StrFilterWhitespace.h>
 #include <FTL/StrSplit.h>
 
+#include <string.h>
+#include <set>
+
 using namespace FabricServices::ASTWrapper;
 
 KLASTManager * KLASTManager::s_manager = NULL;
@@ -19,12 +22,21 @@ KLASTManager::KLASTManager(const FabricCore::Client * client)
   if(client)
     m_client = *client;
   m_maxDeclId = 0;
+  m_astRevision = 1;
   m_isUpdatingASTClients = false;
   m_autoLoadExtensions = false;
+  m_extsPathIndexed = false;
+  m_nameLookupRevision = 0;
+  m_fileWatcher = NULL;
+  m_registeredTypeTable = NULL;
 }
 
 KLASTManager::~KLASTManager()
 {
+  delete(m_fileWatcher);
+  if(m_registeredTypeTable)
+    m_registeredTypeTable->release();
+
   for(uint32_t i=0;i<m_extensions.size();i++)
     delete(m_extensions[i]);
 
@@ -96,6 +108,9 @@ void KLASTManager::onExtensionLoaded(const KLExtension * extension)
 
 void KLASTManager::onExtensionParsed(const KLExtension * extension)
 {
+  // the extension might have registered new types with the core
+  if(m_registeredTypeTable)
+    m_registeredTypeTable->invalidate();
   for(size_t i=0;i<m_astClients.size();i++)
   {
     m_astClients[i]->onExtensionParsed(extension);
@@ -109,6 +124,8 @@ void KLASTManager::onFileLoaded(const KLFile * file)
   {
     m_astClients[i]->onFileLoaded(file);
   }
+  if(m_fileWatcher)
+    m_fileWatcher->watchFile(file->getAbsoluteFilePath());
   onASTChanged();
 }
 
@@ -121,8 +138,18 @@ void KLASTManager::onFileParsed(const KLFile * file)
   onASTChanged();
 }
 
+void KLASTManager::onFilesChanged(const std::vector<const KLFile*> & files)
+{
+  for(size_t i=0;i<m_astClients.size();i++)
+  {
+    m_astClients[i]->onFilesChanged(files);
+  }
+}
+
 void KLASTManager::onASTChanged()
 {
+  bumpASTRevision();
+
   for(size_t i=0;i<m_astClients.size();i++)
   {
     m_astClients[i]->onASTChanged();
@@ -164,58 +191,9 @@ void KLASTManager::loadAllExtensionsInFolder(const char * extensionFolder, bool
   std::vector<std::string> folders;
   folders.push_back(extensionFolder);
 
-  std::vector<std::string> additionalFolders;
-
-  for(uint32_t i=0;i<folders.size();i++)
-  {
-    std::string const &folder = folders[i];
-
-    std::vector<std::string> entries;
-    if ( !FTL::FSDirAppendEntries( folder, entries ) )
-      continue;
-
-    for ( std::vector<std::string>::const_iterator it = entries.begin();
-      it != entries.end(); ++it )
-    {
-      std::string const &entry = *it;
-      std::string entryPath = FTL::PathJoin( folder, entry );
-      FTL::FSStatInfo entryStatInfo;
-      if ( !FTL::FSStat( entryPath, entryStatInfo ) )
-        continue;
-      switch ( entryStatInfo.type )
-      {
-        case FTL::FSStatInfo::Dir:
-          additionalFolders.push_back( entryPath );
-          break;
-
-        case FTL::FSStatInfo::File:
-          if ( entry.length() >= 9
-              && entry.substr(entry.length()-9, 9) == ".fpm.json" )
-          {
-            try
-            {
-              KLExtension * extension = new KLExtension(this, entryPath.c_str(), NULL);
-              onExtensionLoaded(extension);
-              m_extensions.push_back(extension);
-            }
-            catch(FabricCore::Exception e)
-            {
-              printf("[KLASTManager] Ignoring extension '%s': '%s'.\n", entryPath.c_str(), e.getDesc_cstr());
-            }
-          }
-          break;
-
-        default:
-          break;
-      }
-    }
-  }
-
-  for ( std::vector<std::string>::const_iterator it = additionalFolders.begin();
-    it != additionalFolders.end(); ++it )
-  {
-    loadAllExtensionsInFolder( it->c_str(), false );
-  }
+  std::vector<KLExtensionCrawler::Entry> entries = KLExtensionCrawler::crawl(folders);
+  for(size_t i=0;i<entries.size();i++)
+    loadExtensionFromPath(entries[i].path, false);
 
   if(parseExtensions)
   {
@@ -234,14 +212,11 @@ bool KLASTManager::loadAllExtensionsFromExtsPath(bool parseExtensions)
   if(m_extensions.size() >  0)
     return false;
 
-  std::vector<std::string> folders;
-  if ( !FTL::EnvGetList( "FABRIC_EXTS_PATH", folders ) )
+  if(!buildExtsPathIndex())
     return false;
 
-  for(size_t i=0;i<folders.size();i++)
-  {
-    loadAllExtensionsInFolder(folders[i].c_str(), false);
-  }
+  for(size_t i=0;i<m_extsPathEntries.size();i++)
+    loadExtensionFromPath(m_extsPathEntries[i].path, false);
 
   if(parseExtensions)
   {
@@ -261,51 +236,9 @@ const KLExtension* KLASTManager::loadExtensionFromFolder(
   std::string const &folder
   )
 {
-  std::vector<std::string> entries;
-  FTL::FSDirAppendEntries( folder, entries );
-
-  KLExtension const *result = NULL;
-  for ( std::vector<std::string>::const_iterator it = entries.begin();
-    !result && it != entries.end(); ++it )
-  {
-    std::string const &entry = *it;
-    std::string entryPath = FTL::PathJoin( folder, entry );
-
-    FTL::FSStatInfo statInfo;
-    if ( !FSStat( entryPath, statInfo ) )
-      continue;
-
-    switch ( statInfo.type )
-    {
-      case FTL::FSStatInfo::Dir:
-        result = loadExtensionFromFolder( name, entryPath );
-        break;
-
-      case FTL::FSStatInfo::File:
-        if ( entry == std::string(name) + ".fpm.json" )
-        {
-          try
-          {
-            KLExtension *klExtension =
-              new KLExtension(this, entryPath.c_str(), NULL);
-            onExtensionLoaded(klExtension);
-            m_extensions.push_back(klExtension);
-            klExtension->parse();
-            onExtensionParsed(klExtension);
-            result = klExtension;
-          }
-          catch(FabricCore::Exception e)
-          {
-            printf("[KLASTManager] Ignoring extension '%s': '%s'.\n", entryPath.c_str(), e.getDesc_cstr());
-          }
-        }
-        break;
-
-      default:
-        break;
-    }
-  }
-  return result;
+  std::vector<std::string> folders;
+  folders.push_back(folder);
+  return loadExtensionFromFolders( name, folders );
 }
 
 const KLExtension* KLASTManager::loadExtensionFromFolders(
@@ -313,15 +246,38 @@ const KLExtension* KLASTManager::loadExtensionFromFolders(
   std::vector<std::string> const &folders
   )
 {
-  KLExtension const *result = NULL;
-  for(uint32_t i=0;i<folders.size();i++)
+  std::vector<KLExtensionCrawler::Entry> entries = KLExtensionCrawler::crawl(folders);
+  for(size_t i=0;i<entries.size();i++)
   {
-    std::string const &folder = folders[i];
-    result = loadExtensionFromFolder( name, folder );
-    if ( result )
-      break;
+    if(entries[i].name != name)
+      continue;
+    const KLExtension * result = loadExtensionFromPath(entries[i].path, true);
+    if(result)
+      return result;
   }
-  return result;
+  return NULL;
+}
+
+const KLExtension* KLASTManager::loadExtensionFromPath(std::string const &jsonFilePath, bool parseExtension)
+{
+  try
+  {
+    KLExtension *klExtension =
+      new KLExtension(this, jsonFilePath.c_str(), NULL);
+    onExtensionLoaded(klExtension);
+    m_extensions.push_back(klExtension);
+    if(parseExtension)
+    {
+      klExtension->parse();
+      onExtensionParsed(klExtension);
+    }
+    return klExtension;
+  }
+  catch(FabricCore::Exception e)
+  {
+    printf("[KLASTManager] Ignoring extension '%s': '%s'.\n", jsonFilePath.c_str(), e.getDesc_cstr());
+  }
+  return NULL;
 }
 
 const KLExtension* KLASTManager::loadExtensionFromExtsPath(const char * name)
@@ -329,11 +285,46 @@ const KLExtension* KLASTManager::loadExtensionFromExtsPath(const char * name)
   if(getExtension(name))
     return NULL;
 
+  if(!buildExtsPathIndex())
+    return NULL;
+
+  std::map<std::string, std::vector<std::string> >::const_iterator it = m_extsPathIndex.find(name);
+  if(it == m_extsPathIndex.end())
+    return NULL;
+
+  const std::vector<std::string> & paths = it->second;
+  for(size_t i=0;i<paths.size();i++)
+  {
+    const KLExtension * result = loadExtensionFromPath(paths[i], true);
+    if(result)
+      return result;
+  }
+  return NULL;
+}
+
+bool KLASTManager::buildExtsPathIndex()
+{
+  if(m_extsPathIndexed)
+    return true;
+
   std::vector<std::string> folders;
   if ( !FTL::EnvGetList( "FABRIC_EXTS_PATH", folders ) )
-    return NULL;
+    return false;
 
-  return loadExtensionFromFolders( name, folders );
+  m_extsPathEntries = KLExtensionCrawler::crawl(folders);
+  m_extsPathIndex.clear();
+  for(size_t i=0;i<m_extsPathEntries.size();i++)
+    m_extsPathIndex[m_extsPathEntries[i].name].push_back(m_extsPathEntries[i].path);
+
+  m_extsPathIndexed = true;
+  return true;
+}
+
+void KLASTManager::invalidateExtsPathIndex()
+{
+  m_extsPathIndexed = false;
+  m_extsPathEntries.clear();
+  m_extsPathIndex.clear();
 }
 
 bool KLASTManager::removeExtension(const char * name, const char * versionRequirement)
@@ -345,8 +336,15 @@ bool KLASTManager::removeExtension(const char * name, const char * versionRequir
     {
       if(m_extensions[i] == extension)
       {
+        if(m_fileWatcher)
+        {
+          std::vector<const KLFile*> files = extension->getFiles();
+          for(size_t j=0;j<files.size();j++)
+            m_fileWatcher->unwatchFile(files[j]->getAbsoluteFilePath());
+        }
         delete(m_extensions[i]);
         m_extensions.erase(m_extensions.begin() + i);
+        onASTChanged();
         return true;
       }
     }
@@ -354,6 +352,130 @@ bool KLASTManager::removeExtension(const char * name, const char * versionRequir
   return false;
 }
 
+bool KLASTManager::getWatchFiles() const
+{
+  return m_fileWatcher != NULL;
+}
+
+void KLASTManager::setWatchFiles(bool state)
+{
+  if(state == (m_fileWatcher != NULL))
+    return;
+
+  if(!state)
+  {
+    delete(m_fileWatcher);
+    m_fileWatcher = NULL;
+    return;
+  }
+
+  m_fileWatcher = new KLFileWatcher();
+  for(size_t i=0;i<m_extensions.size();i++)
+  {
+    std::vector<const KLFile*> files = m_extensions[i]->getFiles();
+    for(size_t j=0;j<files.size();j++)
+      m_fileWatcher->watchFile(files[j]->getAbsoluteFilePath());
+  }
+  m_fileWatcher->start();
+}
+
+uint32_t KLASTManager::processFileChanges()
+{
+  if(!m_fileWatcher)
+    return 0;
+
+  std::vector<std::string> filePaths = m_fileWatcher->takeChangedFiles();
+  if(filePaths.size() == 0)
+    return 0;
+
+  std::vector<const KLFile*> changedFiles;
+  for(size_t i=0;i<filePaths.size();i++)
+  {
+    KLFile * file = NULL;
+    for(size_t j=0;j<m_extensions.size() && !file;j++)
+    {
+      std::vector<const KLFile*> files = m_extensions[j]->getFiles();
+      for(size_t k=0;k<files.size();k++)
+      {
+        if(filePaths[i] == files[k]->getAbsoluteFilePath())
+        {
+          file = (KLFile*)files[k];
+          break;
+        }
+      }
+    }
+    if(!file)
+      continue;
+
+    // a file which was removed is kept as is, same for
+    // a file which was only touched without any edit.
+    std::string code;
+    if(!KLSourceFile::read(filePaths[i].c_str(), code))
+      continue;
+    if(code == file->getKLCode())
+      continue;
+
+    file->updateKLCode(code.c_str());
+    changedFiles.push_back(file);
+  }
+
+  if(changedFiles.size() > 0)
+    onFilesChanged(changedFiles);
+  return changedFiles.size();
+}
+
+bool KLASTManager::saveSymbolDatabase(const char * filePath) const
+{
+  return KLSymbolDatabase::write(filePath, m_extensions);
+}
+
+bool KLASTManager::loadSymbolDatabase(const char * filePath, bool parseExtensions)
+{
+  // the files copy their code and stored AST, so the
+  // database is closed again once the extensions are loaded.
+  KLSymbolDatabase database;
+  if(!database.open(filePath))
+    return false;
+
+  std::vector<KLExtension*> extensions;
+  const std::vector<KLSymbolDatabase::ExtensionRecord> & records = database.getExtensions();
+  for(size_t i=0;i<records.size();i++)
+  {
+    const KLSymbolDatabase::ExtensionRecord & record = records[i];
+    if(getExtension(record.name))
+      continue;
+
+    std::vector<const char *> klContent;
+    for(size_t j=0;j<record.files.size();j++)
+      klContent.push_back(record.files[j].code);
+
+    try
+    {
+      KLExtension * extension = new KLExtension(this, record.name, record.manifest, klContent.size(), klContent.size() > 0 ? &klContent[0] : NULL, NULL, record.filePath);
+      for(size_t j=0;j<extension->m_files.size();j++)
+        ((KLFile*)extension->m_files[j])->setCachedJSONAST(record.files[j].jsonAST);
+      onExtensionLoaded(extension);
+      m_extensions.push_back(extension);
+      extensions.push_back(extension);
+    }
+    catch(FabricCore::Exception e)
+    {
+      printf("[KLASTManager] Ignoring extension '%s': '%s'.\n", record.name, e.getDesc_cstr());
+    }
+  }
+
+  if(parseExtensions)
+  {
+    for(size_t i=0;i<extensions.size();i++)
+    {
+      extensions[i]->parse();
+      onExtensionParsed(extensions[i]);
+    }
+  }
+
+  return extensions.size() > 0;
+}
+
 const KLFile* KLASTManager::loadSingleKLFile(const char * klFileName, const char * klContent, FabricCore::DFGExec *dfgExec)
 {
   loadAllExtensionsFromExtsPath(false);
@@ -434,6 +556,73 @@ std::vector<const KLFunction*> KLASTManager::getFunctions() const
   return result;
 }
 
+std::vector<const KLFunction*> KLASTManager::getFunctionsByName(const char * name) const
+{
+  validateNameLookups();
+  std::map<std::string, std::vector<const KLFunction*> >::const_iterator it = m_functionsByName.find(name);
+  if(it == m_functionsByName.end())
+    return std::vector<const KLFunction*>();
+  return it->second;
+}
+
+const KLConstant * KLASTManager::getConstantByName(const char * name) const
+{
+  validateNameLookups();
+  std::map<std::string, const KLConstant*>::const_iterator it = m_constantsByName.find(name);
+  if(it == m_constantsByName.end())
+    return NULL;
+  return it->second;
+}
+
+std::string KLASTManager::resolveAlias(const char * name) const
+{
+  validateNameLookups();
+  std::map<std::string, std::string>::const_iterator it = m_resolvedAliases.find(name);
+  if(it == m_resolvedAliases.end())
+    return name;
+  return it->second;
+}
+
+void KLASTManager::validateNameLookups() const
+{
+  if(m_nameLookupRevision == m_astRevision)
+    return;
+  m_nameLookupRevision = m_astRevision;
+
+  m_functionsByName.clear();
+  std::vector<const KLFunction*> functions = getFunctions();
+  for(size_t i=0;i<functions.size();i++)
+    m_functionsByName[functions[i]->getName()].push_back(functions[i]);
+
+  // the first declaration of a name wins
+  m_constantsByName.clear();
+  std::vector<const KLConstant*> constants = getConstants();
+  for(size_t i=0;i<constants.size();i++)
+    m_constantsByName.insert(std::pair<std::string, const KLConstant*>(constants[i]->getName(), constants[i]));
+
+  std::map<std::string, std::string> aliasTargets;
+  std::vector<const KLAlias*> aliases = getAliases();
+  for(size_t i=0;i<aliases.size();i++)
+    aliasTargets.insert(std::pair<std::string, std::string>(aliases[i]->getNewUserName(), aliases[i]->getOldUserName()));
+
+  // precompute the end of each alias chain, stopping at cycles
+  m_resolvedAliases.clear();
+  for(std::map<std::string, std::string>::const_iterator it = aliasTargets.begin(); it != aliasTargets.end(); it++)
+  {
+    std::set<std::string> visited;
+    visited.insert(it->first);
+    std::string target = it->second;
+    for(;;)
+    {
+      std::map<std::string, std::string>::const_iterator next = aliasTargets.find(target);
+      if(next == aliasTargets.end() || !visited.insert(target).second)
+        break;
+      target = next->second;
+    }
+    m_resolvedAliases.insert(std::pair<std::string, std::string>(it->first, target));
+  }
+}
+
 std::vector<const KLInterface*> KLASTManager::getInterfaces() const
 {
   std::vector<const KLInterface*> result;
@@ -702,3 +891,30 @@ uint32_t KLASTManager::generateDeclId()
 {
   return m_maxDeclId++;
 }
+
+const KLReferenceIndex * KLASTManager::getReferenceIndex() const
+{
+  return &m_referenceIndex;
+}
+
+std::vector<KLReference> KLASTManager::getReferences(const char * name) const
+{
+  return m_referenceIndex.getReferences(name);
+}
+
+KLRegisteredTypeTable * KLASTManager::getRegisteredTypeTable() const
+{
+  if(m_registeredTypeTable == NULL)
+    m_registeredTypeTable = new KLRegisteredTypeTable(&m_client);
+  return m_registeredTypeTable;
+}
+
+uint32_t KLASTManager::getASTRevision() const
+{
+  return m_astRevision;
+}
+
+void KLASTManager::bumpASTRevision()
+{
+  m_astRevision++;
+}
@@ -6,6 +6,11 @@
 #include "KLDeclContainer.h"
 #include "KLLocation.h"
 #include "KLExtension.h"
+#include "KLExtensionCrawler.h"
+#include "KLFileWatcher.h"
+#include "KLReferenceIndex.h"
+#include "KLRegisteredTypeTable.h"
+#include "KLSymbolDatabase.h"
 
 namespace FabricServices
 {
@@ -20,6 +25,7 @@ namespace FabricServices
       friend class KLFile;
       friend class KLExtension;
       friend class KLASTClient;
+      friend class KLType;
 
     public:
 
@@ -37,7 +43,24 @@ namespace FabricServices
       void loadAllExtensionsInFolder(const char * extensionFolder, bool parseExtensions = true);
       bool loadAllExtensionsFromExtsPath(bool parseExtensions = true);
       const KLExtension* loadExtensionFromExtsPath(const char * name);
+      // drops the cached FABRIC_EXTS_PATH index, the
+      // next lookup will crawl the folders again.
+      void invalidateExtsPathIndex();
+
+      // watches the KL files of all loaded extensions for changes on disk.
+      // changes are only applied when processFileChanges is called, so the
+      // AST is never touched from the watcher thread.
+      bool getWatchFiles() const;
+      void setWatchFiles(bool state);
+      // reparses all files which changed on disk and reports them to the
+      // clients through onFilesChanged. returns the number of files updated.
+      uint32_t processFileChanges();
       bool removeExtension(const char * name, const char * versionRequirement = "*");
+      // writes all loaded extensions including their compiled ASTs into a
+      // single symbol database, which can be loaded later without running
+      // the KL compiler. extensions already loaded are skipped on load.
+      bool saveSymbolDatabase(const char * filePath) const;
+      bool loadSymbolDatabase(const char * filePath, bool parseExtensions = true);
       const KLFile* loadSingleKLFile(const char * klFileName, const char * klContent, FabricCore::DFGExec *dfgExec);
 
       std::vector<const KLExtension*> getExtensions() const;
@@ -55,6 +78,15 @@ namespace FabricServices
       virtual std::vector<const KLStruct*> getStructs() const;
       virtual std::vector<const KLObject*> getObjects() const;
 
+      // name keyed lookups across all extensions, built once per AST revision.
+      // overloads are returned in the order of getFunctions. the results are
+      // copies, the lookups are rebuilt whenever the AST changes.
+      std::vector<const KLFunction*> getFunctionsByName(const char * name) const;
+      const KLConstant * getConstantByName(const char * name) const;
+      // follows the chain of aliases for a name, returns the
+      // name itself if it isn't an alias.
+      std::string resolveAlias(const char * name) const;
+
       // returns the KLType of a given name. If the KLDecl is passed,
       // we will try to resolve this within the same extension, or if the
       // extension doesn't define the type, we'll base it off the requires
@@ -68,8 +100,22 @@ namespace FabricServices
       virtual const KLExtension* getExtension(const char * name, const char * versionRequirement = "*") const;
       virtual const KLExtension* getExtension(const KLRequire* require) const;
 
+      // the reverse index of all references to types and functions
+      // across the loaded code, kept up to date as files are parsed.
+      const KLReferenceIndex * getReferenceIndex() const;
+      std::vector<KLReference> getReferences(const char * name) const;
+
+      // the basic types registered with the core, shared by all users of
+      // the manager. callers retain the table if they outlive the manager.
+      KLRegisteredTypeTable * getRegisteredTypeTable() const;
+
+      // the revision is bumped whenever the AST changes,
+      // decls use it to validate their cached lookups.
+      uint32_t getASTRevision() const;
+
     protected: 
       uint32_t generateDeclId();
+      void bumpASTRevision();
 
       void registerASTClient(KLASTClient * client);
       void unregisterASTClient(KLASTClient * client);
@@ -77,10 +123,14 @@ namespace FabricServices
       void onExtensionParsed(const KLExtension * extension);
       void onFileLoaded(const KLFile * file);
       void onFileParsed(const KLFile * file);
+      void onFilesChanged(const std::vector<const KLFile*> & files);
       void onASTChanged();
 
       const KLExtension* loadExtensionFromFolder(const char * name, std::string const &folder);
       const KLExtension* loadExtensionFromFolders(const char * name, std::vector<std::string> const &folders);
+      const KLExtension* loadExtensionFromPath(std::string const &jsonFilePath, bool parseExtension);
+      bool buildExtsPathIndex();
+      void validateNameLookups() const;
 
     private:
       FabricCore::Client m_client;
@@ -88,9 +138,25 @@ namespace FabricServices
       std::vector<KLFile*> m_files;
       std::vector<KLASTClient*> m_astClients;
       uint32_t m_maxDeclId;
+      uint32_t m_astRevision;
       bool m_isUpdatingASTClients;
       bool m_autoLoadExtensions;
 
+      // all extensions found below FABRIC_EXTS_PATH, crawled once
+      bool m_extsPathIndexed;
+      std::vector<KLExtensionCrawler::Entry> m_extsPathEntries;
+      std::map<std::string, std::vector<std::string> > m_extsPathIndex;
+
+      // name lookups, stamped with the AST revision they were built for
+      mutable uint32_t m_nameLookupRevision;
+      mutable std::map<std::string, std::vector<const KLFunction*> > m_functionsByName;
+      mutable std::map<std::string, const KLConstant*> m_constantsByName;
+      mutable std::map<std::string, std::string> m_resolvedAliases;
+
+      KLFileWatcher * m_fileWatcher;
+      KLReferenceIndex m_referenceIndex;
+      mutable KLRegisteredTypeTable * m_registeredTypeTable;
+
       static KLASTManager * s_manager;
       static uint32_t s_managerRefs;
     };
@@ -0,0 +1,95 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLArena.h"
+
+#include <stdlib.h>
+#include <new>
+
+using namespace FabricServices::ASTWrapper;
+
+// all allocations are aligned to 16 bytes, which covers
+// every member type used by the AST classes
+#define KLARENA_ALIGNMENT 16
+#define KLARENA_ALIGN(size) (((size) + KLARENA_ALIGNMENT - 1) & ~(size_t)(KLARENA_ALIGNMENT - 1))
+
+KLArena::KLArena(size_t blockSize)
+{
+  m_blockSize = blockSize;
+  m_cursor = NULL;
+  m_remaining = 0;
+  m_bytesUsed = 0;
+}
+
+KLArena::~KLArena()
+{
+  for(size_t i=0;i<m_blocks.size();i++)
+    free(m_blocks[i]);
+}
+
+void * KLArena::allocate(size_t size)
+{
+  size = KLARENA_ALIGN(size);
+  if(size > m_remaining)
+    addBlock(size);
+
+  void * result = m_cursor;
+  m_cursor += size;
+  m_remaining -= size;
+  m_bytesUsed += size;
+  return result;
+}
+
+void KLArena::reset()
+{
+  // keep the first block around, a file which is
+  // reparsed will most likely need it again
+  for(size_t i=1;i<m_blocks.size();i++)
+    free(m_blocks[i]);
+  if(m_blocks.size() > 1)
+  {
+    m_blocks.resize(1);
+    m_blockSizes.resize(1);
+  }
+
+  if(m_blocks.size() > 0)
+  {
+    m_cursor = m_blocks[0];
+    m_remaining = m_blockSizes[0];
+  }
+  else
+  {
+    m_cursor = NULL;
+    m_remaining = 0;
+  }
+  m_bytesUsed = 0;
+}
+
+size_t KLArena::getBytesUsed() const
+{
+  return m_bytesUsed;
+}
+
+size_t KLArena::getBytesReserved() const
+{
+  size_t result = 0;
+  for(size_t i=0;i<m_blockSizes.size();i++)
+    result += m_blockSizes[i];
+  return result;
+}
+
+void KLArena::addBlock(size_t minSize)
+{
+  size_t size = m_blockSize;
+  if(size < minSize)
+    size = minSize;
+
+  // malloc guarantees an alignment suitable for any type
+  char * block = (char*)malloc(size);
+  if(!block)
+    throw(std::bad_alloc());
+
+  m_blocks.push_back(block);
+  m_blockSizes.push_back(size);
+  m_cursor = block;
+  m_remaining = size;
+}
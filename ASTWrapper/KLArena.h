@@ -0,0 +1,52 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLArena__
+#define __ASTWrapper_KLArena__
+
+#include <stddef.h>
+#include <vector>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+
+    // A monotonic allocator owned by each KLFile. All decls and
+    // statements of a file are placed in its arena, so tearing down
+    // the tree only runs the destructors and then drops the blocks
+    // in one go instead of freeing every node individually.
+    class KLArena
+    {
+    public:
+
+      KLArena(size_t blockSize = 64 * 1024);
+      ~KLArena();
+
+      void * allocate(size_t size);
+      void reset();
+
+      size_t getBytesUsed() const;
+      size_t getBytesReserved() const;
+
+    private:
+
+      // non copyable
+      KLArena(const KLArena & other);
+      KLArena & operator = (const KLArena & other);
+
+      void addBlock(size_t minSize);
+
+      size_t m_blockSize;
+      std::vector<char*> m_blocks;
+      std::vector<size_t> m_blockSizes;
+      char * m_cursor;
+      size_t m_remaining;
+      size_t m_bytesUsed;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLArena__
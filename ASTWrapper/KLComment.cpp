@@ -3,17 +3,20 @@
 #include "KLComment.h"
 #include "KLCommented.h"
 #include "KLStruct.h"
+#include "KLASTManager.h"
 
 #include <FTL/MatchChar.h>
 #include <FTL/MatchPrefix.h>
 #include <FTL/Str.h>
 #include <limits.h>
+#include <ctype.h>
 
 using namespace FabricServices::ASTWrapper;
 
 KLComment::KLComment(const KLFile* klFile, const KLNameSpace * nameSpace, const KLCommented * owner, JSONData data)
 : KLDecl(klFile, nameSpace, data)
 , m_owner(owner)
+, m_parentCacheRevision(0)
 {
   gatherDoxygenContent();
 }
@@ -82,6 +85,105 @@ void KLComment::gatherDoxygenContent() const
       }
     }
   }
+
+  indexQualifiers();
+}
+
+void KLComment::indexQualifiers() const
+{
+  m_qualifierIndex.clear();
+  m_plainLines.clear();
+  m_bracketQualifiers.clear();
+  m_parentQualifiers.clear();
+  m_parentHasQualifier.clear();
+
+  std::string insideQualifier;
+  for(uint32_t i=0;i<m_content.size();i++)
+  {
+    std::string l = m_content[i];
+    FTL::StrTrimWhitespace(l);
+
+    if(l.substr(0, 1) == "\\")
+    {
+      // the name ends at the first non identifier character,
+      // so \param[in] is indexed as param
+      size_t end = 1;
+      while(end < l.length() && (isalnum((unsigned char)l[end]) || l[end] == '_'))
+        end++;
+
+      std::string q = l.substr(1, end - 1);
+      FTL::StrToLower(q);
+      std::string text = l.substr(end, std::string::npos);
+      FTL::StrTrimWhitespace(text);
+      m_qualifierIndex[q].push_back(text);
+
+      if(FTL::StrCount<' '>(l) == 0)
+      {
+        if(insideQualifier.length() > 0)
+        {
+          if(q == "end"+insideQualifier)
+            insideQualifier = "";
+        }
+        else
+        {
+          insideQualifier = q;
+        }
+      }
+      continue;
+    }
+
+    if(insideQualifier.length() == 0)
+      m_plainLines.push_back(l);
+  }
+}
+
+std::string KLComment::getLocalQualifier(const std::string & q) const
+{
+  const std::vector<std::string> * content = NULL;
+  if(q == "")
+  {
+    content = &m_plainLines;
+  }
+  else
+  {
+    std::map<std::string, std::vector<std::string> >::const_iterator it = m_qualifierIndex.find(q);
+    if(it != m_qualifierIndex.end())
+      content = &it->second;
+  }
+
+  std::string result;
+  if(content)
+  {
+    for(size_t i=0;i<content->size();i++)
+    {
+      if(i>0)
+        result += "\n";
+      result += (*content)[i];
+    }
+  }
+
+  if(q == "plaintext")
+  {
+    for(size_t i=0;i<m_plainLines.size();i++)
+    {
+      if(result.length() > 0 || i>0)
+        result += "\n";
+      result += m_plainLines[i];
+    }
+  }
+
+  return result;
+}
+
+bool KLComment::validateParentCaches() const
+{
+  uint32_t revision = getASTManager()->getASTRevision();
+  if(m_parentCacheRevision == revision)
+    return true;
+  m_parentQualifiers.clear();
+  m_parentHasQualifier.clear();
+  m_parentCacheRevision = revision;
+  return false;
 }
 
 bool KLComment::isEmpty() const
@@ -105,23 +207,19 @@ bool KLComment::hasQualifier(
   if(q.length() == 0)
     return true;
 
-  std::map<std::string, std::string>::iterator it = m_qualifiers.find(q);
-  if(it != m_qualifiers.end())
+  if(m_qualifierIndex.find(q) != m_qualifierIndex.end())
     return true;
 
-  for(uint32_t i=0;i<m_content.size();i++)
-  {
-    std::string l = m_content[i];
-    FTL::StrTrimWhitespace(l);
-    FTL::StrToLower(l);
-    if(l.substr(0, q.length()+1) == "\\"+q)
-      return true;
-  }
-
   // check if the parents have some
   if ( searchParents
     && m_owner->isOfDeclType(KLDeclType_Struct) )
   {
+    validateParentCaches();
+    std::map<std::string, bool>::const_iterator it = m_parentHasQualifier.find(q);
+    if(it != m_parentHasQualifier.end())
+      return it->second;
+
+    bool found = false;
     const KLStruct * klStruct = (const KLStruct *)m_owner;
     std::vector<const KLType*> parents = klStruct->getParents();
     for(size_t i=0;i<parents.size();i++)
@@ -130,8 +228,14 @@ bool KLComment::hasQualifier(
         qualifier,
         searchParents
         ) )
-        return true;
+      {
+        found = true;
+        break;
+      }
     }
+
+    m_parentHasQualifier.insert(std::pair<std::string, bool>(q, found));
+    return found;
   }
 
   return false;
@@ -147,52 +251,18 @@ std::string KLComment::getQualifier(const char * qualifier, const char * default
     FTL::StrTrimWhitespace(q);
   }
 
-  std::map<std::string, std::string>::iterator it = m_qualifiers.find(q);
-  if(it != m_qualifiers.end())
-    return it->second;
-
-  std::vector<std::string> content;
-  std::string insideQualifier;
+  std::string result = getLocalQualifier(q);
 
-  for(uint32_t i=0;i<m_content.size();i++)
+  // check if any parent has something for us
+  if(result.length() == 0 && m_owner->isOfDeclType(KLDeclType_Struct))
   {
-    std::string l = m_content[i];
-    FTL::StrTrimWhitespace(l);
-    std::string lPrefix = l.substr(0, q.length() + 1);
-    FTL::StrToLower(lPrefix);
-
-    if(lPrefix == "\\"+q && q != "")
+    validateParentCaches();
+    std::map<std::string, std::string>::const_iterator it = m_parentQualifiers.find(q);
+    if(it != m_parentQualifiers.end())
     {
-      std::string l2 = l.substr(q.length()+1, 10000);
-      FTL::StrTrimWhitespace(l2);
-      content.push_back(l2);
+      result = it->second;
     }
-
-    if(l.substr(0, 1) == "\\" && FTL::StrCount<' '>(l) == 0)
-    {
-      if(insideQualifier.length() > 0)
-      {
-        if(l == "\\end"+insideQualifier)
-          insideQualifier = "";
-      }
-      else
-      {
-        insideQualifier = l.substr(1, 10000);
-      }
-    }
-
-    if((q == "" || q == "plaintext") && l.substr(0, 1) != "\\" && insideQualifier.length() == 0)
-    {
-      content.push_back(l);
-    }
-  }
-
-  std::string result;
-
-  // check if any parent has something for us
-  if(content.size() == 0)
-  {
-    if(m_owner->isOfDeclType(KLDeclType_Struct))
+    else
     {
       const KLStruct * klStruct = (const KLStruct *)m_owner;
       std::vector<const KLType*> parents = klStruct->getParents();
@@ -200,25 +270,14 @@ std::string KLComment::getQualifier(const char * qualifier, const char * default
       {
         result = parents[i]->getComments()->getQualifier(qualifier);
         if(result.length() > 0)
-        {
-          m_qualifiers.insert(std::pair<std::string, std::string>(q, result));
-          return result;          
-        }
+          break;
       }
-    }    
-  }
-
-  if(content.size() == 0 && defaultResult)
-    content.push_back(defaultResult);
-
-  for(uint32_t i=0;i<content.size();i++)
-  {
-    if(i>0)
-      result += "\n";
-    result += content[i];
+      m_parentQualifiers.insert(std::pair<std::string, std::string>(q, result));
+    }
   }
 
-  m_qualifiers.insert(std::pair<std::string, std::string>(q, result));
+  if(result.length() == 0 && defaultResult)
+    result = defaultResult;
 
   return result;
 }
@@ -267,9 +326,13 @@ std::string KLComment::getQualifierBracket(const char * qualifier, const char *
   if(q1.length() == 0)
     return "";
 
-  std::map<std::string, std::string>::iterator it = m_qualifiers.find(q1);
-  if(it != m_qualifiers.end())
+  std::map<std::string, std::string>::iterator it = m_bracketQualifiers.find(q1);
+  if(it != m_bracketQualifiers.end())
+  {
+    if(it->second.length() == 0 && defaultResult)
+      return defaultResult;
     return it->second;
+  }
 
   std::string q2 = "end" + q1;
 
@@ -324,9 +387,6 @@ std::string KLComment::getQualifierBracket(const char * qualifier, const char *
     }
   }
 
-  if(content.size() == 0 && defaultResult)
-    content.push_back(defaultResult);
-
   std::string result;
   for(uint32_t i=0;i<content.size();i++)
   {
@@ -335,8 +395,10 @@ std::string KLComment::getQualifierBracket(const char * qualifier, const char *
     result += content[i];
   }
 
-  m_qualifiers.insert(std::pair<std::string, std::string>(q1, result));
+  m_bracketQualifiers.insert(std::pair<std::string, std::string>(q1, result));
 
+  if(content.size() == 0 && defaultResult)
+    return defaultResult;
   return result;
 }
 
@@ -495,4 +557,5 @@ std::vector<std::string> KLComment::getContentAsVector() const
 void KLComment::appendToContent(std::vector<std::string> content) const
 {
   m_content.insert(m_content.end(), content.begin(), content.end());
+  indexQualifiers();
 }
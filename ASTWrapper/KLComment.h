@@ -58,10 +58,23 @@ namespace FabricServices
     private:
 
       void gatherDoxygenContent() const;
+      void indexQualifiers() const;
+      std::string getLocalQualifier(const std::string & q) const;
+      bool validateParentCaches() const;
 
       const KLCommented * m_owner;
       mutable std::vector<std::string> m_content;
-      mutable std::map<std::string, std::string> m_qualifiers;
+
+      // lowercase qualifier -> text following it, one entry per occurrence
+      mutable std::map<std::string, std::vector<std::string> > m_qualifierIndex;
+      // lines which are neither qualifiers nor inside a qualifier block
+      mutable std::vector<std::string> m_plainLines;
+      mutable std::map<std::string, std::string> m_bracketQualifiers;
+
+      // lazily resolved results from the parent chain
+      mutable uint32_t m_parentCacheRevision;
+      mutable std::map<std::string, std::string> m_parentQualifiers;
+      mutable std::map<std::string, bool> m_parentHasQualifier;
     };
 
   };
@@ -10,12 +10,12 @@ KLCommented::KLCommented(const KLFile* klFile, const KLNameSpace * nameSpace, JS
   JSONData preComments = getDictValue("preComments");
   if(preComments)
   {
-    m_comments = new KLComment(klFile, nameSpace, this, preComments);
+    m_comments = new(getArena()) KLComment(klFile, nameSpace, this, preComments);
   }
   else
   {
     FabricCore::Variant variant = FabricCore::Variant::CreateArray();
-    m_comments = new KLComment(klFile, nameSpace, this, &variant);
+    m_comments = new(getArena()) KLComment(klFile, nameSpace, this, &variant);
   }
 }
 
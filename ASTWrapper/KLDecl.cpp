@@ -24,7 +24,7 @@ KLDecl::KLDecl(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData dat
   {
     JSONData location = m_data->getDictValue("sourceInfo");
     if(location)
-      m_location = new KLLocation(location);
+      m_location = new(getArena()) KLLocation(location);
   }
 }
 
@@ -34,6 +34,22 @@ KLDecl::~KLDecl()
     delete(m_location);
 }
 
+void * KLDecl::operator new(size_t size, KLArena * arena)
+{
+  return arena->allocate(size);
+}
+
+void KLDecl::operator delete(void * ptr, KLArena * arena)
+{
+  // only invoked if a constructor throws,
+  // the memory is reclaimed with the arena
+}
+
+void KLDecl::operator delete(void * ptr)
+{
+  // the destructor has run, the memory is reclaimed with the arena
+}
+
 uint32_t KLDecl::getID() const
 {
   return m_id;
@@ -77,6 +93,11 @@ const KLLocation * KLDecl::getLocation() const
   return m_location;
 }
 
+KLArena * KLDecl::getArena() const
+{
+  return m_klFile->getArena();
+}
+
 uint32_t KLDecl::getArraySize() const
 {
   if(!m_data->isArray())
@@ -7,6 +7,8 @@
 
 #include <string>
 
+#include "KLArena.h"
+
 namespace FabricServices
 {
 
@@ -68,10 +70,18 @@ namespace FabricServices
       virtual KLDeclType getDeclType() const = 0;
       virtual bool isOfDeclType(KLDeclType type) const = 0;
 
+      // decls are always placed in the arena of their KLFile,
+      // the memory is reclaimed when the file's arena is reset.
+      static void * operator new(size_t size, KLArena * arena);
+      static void operator delete(void * ptr, KLArena * arena);
+      static void operator delete(void * ptr);
+
     protected:
 
       KLDecl(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData data);
 
+      KLArena * getArena() const;
+
       uint32_t getArraySize() const;
       const char * getStringArrayElement(uint32_t index) const;
       const char * getStringDictValue(const char * key) const;
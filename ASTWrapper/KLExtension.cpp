@@ -55,8 +55,8 @@ KLExtension::KLExtension(const KLASTManager* astManager, const char * jsonFilePa
 
   m_filePath = jsonFilePath;
 
-  FILE * jsonFile = fopen(jsonFilePath, "rb");
-  if(!jsonFile)
+  std::string jsonContent;
+  if(!KLSourceFile::read(jsonFilePath, jsonContent))
   {
     std::string message = "KLExtension: jsonFilePath '";
     message += jsonFilePath;
@@ -64,70 +64,39 @@ KLExtension::KLExtension(const KLASTManager* astManager, const char * jsonFilePa
     throw(FabricCore::Exception(message.c_str()));
   }
 
-  fseek( jsonFile, 0, SEEK_END );
-  int jsonFileSize = ftell( jsonFile );
-  rewind( jsonFile );
-
-  char * jsonFileBuffer = (char*) malloc(jsonFileSize + 1);
-  jsonFileBuffer[jsonFileSize] = '\0';
-
-  fread(jsonFileBuffer, jsonFileSize, 1, jsonFile);
-  fclose(jsonFile);
-
-  std::string jsonContent = jsonFileBuffer;
-  free(jsonFileBuffer);
-
   FabricCore::Variant jsonVar = FabricCore::Variant::CreateFromJSON(jsonContent.c_str());
   
+  // the KL code is read straight into strings which are
+  // handed over to the KLFiles in init without a copy.
   std::vector<std::string> klFileRelPaths = extractKLFilePaths(&jsonVar, m_name.c_str());
-  std::vector<std::string> klContent;
+  std::vector<std::string> klCode(klFileRelPaths.size());
   for(uint32_t i=0;i<klFileRelPaths.size();i++)
   {
     std::string klFilePath = klFileRelPaths[i];
     if ( !FTL::PathIsAbsolute( klFilePath ) )
       klFilePath = FTL::PathJoin( jsonFilePathSplit.first, klFileRelPaths[i] );
 
-    if ( !FTL::FSExists( klFilePath ) )
+    if ( !FTL::FSExists( klFilePath ) || !KLSourceFile::read( klFilePath.c_str(), klCode[i] ) )
     {
       std::string message = "KLExtension: '" + m_name + "' uses a non existing KL file '";
       message += klFileRelPaths[i];
       message += "'.";
       throw(FabricCore::Exception(message.c_str()));
     }
-
-    klContent.resize( klContent.size() + 1 );
-    std::string &fileContent = klContent.back();
-
-    FILE * klFile = fopen(klFilePath.c_str(), "rb");
-    for (;;)
-    {
-      size_t oldSize = fileContent.size();
-      fileContent.resize( oldSize + 16384 );
-      size_t readResult = 
-        fread(&fileContent[oldSize], 1, 16384, klFile);
-      fileContent.resize( oldSize + readResult );
-      if ( readResult < 16384 )
-        break;
-    }
-    fclose(klFile);
   }
 
-  std::vector<const char *> klContentCStr;
-  for(uint32_t i=0;i<klFileRelPaths.size();i++)
-  {
-    klContentCStr.push_back(klContent[i].c_str());
-  }
-
-  init(jsonContent.c_str(), klContentCStr.size(), &klContentCStr[0]);
+  init(jsonContent.c_str(), klCode.size(), NULL, klCode.size() > 0 ? &klCode[0] : NULL);
 }
 
-KLExtension::KLExtension(const KLASTManager* astManager, const char * name, const char * jsonContent, uint32_t numKLFiles, const char ** klContent, FabricCore::DFGExec *dfgExec)
+KLExtension::KLExtension(const KLASTManager* astManager, const char * name, const char * jsonContent, uint32_t numKLFiles, const char ** klContent, FabricCore::DFGExec *dfgExec, const char * jsonFilePath)
 
   : m_dfgExec( dfgExec )
 {
   m_astManager = (KLASTManager*)astManager;
   m_name = name;
   m_filePath = m_name + ".fpm.json";
+  if(jsonFilePath)
+    m_filePath = jsonFilePath;
   init(jsonContent, numKLFiles, klContent);
 }
 
@@ -137,7 +106,7 @@ KLExtension::~KLExtension()
     delete(m_files[i]);
 }
 
-void KLExtension::init(const char * jsonContent, uint32_t numKLFiles, const char ** klContent)
+void KLExtension::init(const char * jsonContent, uint32_t numKLFiles, const char ** klContent, std::string * klCode)
 {
   m_parsed = false;
 
@@ -196,11 +165,26 @@ void KLExtension::init(const char * jsonContent, uint32_t numKLFiles, const char
     throw(FabricCore::Exception(message.c_str()));
   }
 
-  for(uint32_t i=0;i<klFilePaths.size();i++)
+  try
+  {
+    for(uint32_t i=0;i<klFilePaths.size();i++)
+    {
+      KLFile * klFile;
+      if(klCode)
+        klFile = new KLFile(this, klFilePaths[i].c_str(), klCode[i]);
+      else
+        klFile = new KLFile(this, klFilePaths[i].c_str(), klContent[i]);
+      m_files.push_back(klFile);
+      getASTManager()->onFileLoaded(klFile);
+    }
+  }
+  catch(...)
   {
-    KLFile * klFile = new KLFile(this, klFilePaths[i].c_str(), klContent[i]);
-    getASTManager()->onFileLoaded(klFile);
-    m_files.push_back(klFile);
+    // the destructor doesn't run for a failed constructor
+    for(uint32_t i=0;i<m_files.size();i++)
+      delete(m_files[i]);
+    m_files.clear();
+    throw;
   }
 }
 
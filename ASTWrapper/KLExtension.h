@@ -4,6 +4,7 @@
 #define __ASTWrapper_KLExtension__
 
 #include "KLDeclContainer.h"
+#include "KLSourceFile.h"
 #include "KLFile.h"
 
 namespace FabricServices
@@ -67,7 +68,7 @@ namespace FabricServices
     protected:
       
       KLExtension(const KLASTManager* astManager, const char * jsonFilePath, FabricCore::DFGExec *dfgExec);
-      KLExtension(const KLASTManager* astManager, const char * name, const char * jsonContent, uint32_t numKLFiles, const char ** klContent, FabricCore::DFGExec *dfgExec);
+      KLExtension(const KLASTManager* astManager, const char * name, const char * jsonContent, uint32_t numKLFiles, const char ** klContent, FabricCore::DFGExec *dfgExec, const char * jsonFilePath = NULL);
 
       void parse();
       void storeForwardDeclComments(const KLType * klType);
@@ -75,7 +76,9 @@ namespace FabricServices
 
     private:
 
-      void init(const char * jsonContent, uint32_t numKLFiles, const char ** klContent);
+      // if klCode is given the files take over its code instead
+      // of copying klContent, leaving the strings empty.
+      void init(const char * jsonContent, uint32_t numKLFiles, const char ** klContent, std::string * klCode = NULL);
       std::vector<std::string> extractKLFilePaths(JSONData data, const char * extensionName);
 
       bool m_parsed;
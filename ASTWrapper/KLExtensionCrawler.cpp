@@ -0,0 +1,173 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLExtensionCrawler.h"
+
+#include <FTL/FS.h>
+#include <FTL/Path.h>
+
+#include <algorithm>
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::Threading;
+
+// the crawl is bound by filesystem latency rather than cpu,
+// but there is no gain in flooding the file server either.
+#define KLEXTENSIONCRAWLER_MAX_THREADS 8
+
+bool KLExtensionCrawler::Entry::operator < (const Entry & other) const
+{
+  if(root != other.root)
+    return root < other.root;
+  if(depth != other.depth)
+    return depth < other.depth;
+  return path < other.path;
+}
+
+class KLExtensionCrawler::Worker : public Thread
+{
+public:
+
+  Worker(KLExtensionCrawler * crawler)
+  : m_crawler(crawler)
+  {
+  }
+
+  virtual ~Worker()
+  {
+    join();
+  }
+
+protected:
+
+  virtual void run()
+  {
+    Folder folder;
+    while(m_crawler->popFolder(folder))
+      m_crawler->processFolder(folder);
+  }
+
+private:
+
+  KLExtensionCrawler * m_crawler;
+};
+
+KLExtensionCrawler::KLExtensionCrawler()
+{
+  m_busy = 0;
+}
+
+std::vector<KLExtensionCrawler::Entry> KLExtensionCrawler::crawl(const std::vector<std::string> & roots, uint32_t numThreads)
+{
+  KLExtensionCrawler crawler;
+  for(uint32_t i=0;i<roots.size();i++)
+  {
+    Folder folder;
+    folder.path = roots[i];
+    folder.root = i;
+    folder.depth = 0;
+    crawler.m_queue.push_back(folder);
+  }
+
+  if(numThreads == 0)
+    numThreads = Thread::getHardwareConcurrency();
+  if(numThreads > KLEXTENSIONCRAWLER_MAX_THREADS)
+    numThreads = KLEXTENSIONCRAWLER_MAX_THREADS;
+
+  std::vector<Worker*> workers;
+  for(uint32_t i=1;i<numThreads;i++)
+  {
+    Worker * worker = new Worker(&crawler);
+    if(!worker->start())
+    {
+      delete(worker);
+      break;
+    }
+    workers.push_back(worker);
+  }
+
+  // the calling thread takes part in the crawl as well
+  Folder folder;
+  while(crawler.popFolder(folder))
+    crawler.processFolder(folder);
+
+  for(size_t i=0;i<workers.size();i++)
+    delete(workers[i]);
+
+  std::sort(crawler.m_entries.begin(), crawler.m_entries.end());
+  return crawler.m_entries;
+}
+
+bool KLExtensionCrawler::popFolder(Folder & folder)
+{
+  MutexLocker locker(m_mutex);
+  for(;;)
+  {
+    if(m_queue.size() > 0)
+    {
+      folder = m_queue.back();
+      m_queue.pop_back();
+      m_busy++;
+      return true;
+    }
+
+    // nothing queued and nobody left who could queue more
+    if(m_busy == 0)
+      return false;
+
+    m_condition.wait(m_mutex);
+  }
+}
+
+void KLExtensionCrawler::processFolder(const Folder & folder)
+{
+  std::vector<Folder> folders;
+  std::vector<Entry> entries;
+
+  std::vector<std::string> dirEntries;
+  if ( FTL::FSDirAppendEntries( folder.path, dirEntries ) )
+  {
+    for ( std::vector<std::string>::const_iterator it = dirEntries.begin();
+      it != dirEntries.end(); ++it )
+    {
+      std::string const &entry = *it;
+      std::string entryPath = FTL::PathJoin( folder.path, entry );
+      FTL::FSStatInfo entryStatInfo;
+      if ( !FTL::FSStat( entryPath, entryStatInfo ) )
+        continue;
+      switch ( entryStatInfo.type )
+      {
+        case FTL::FSStatInfo::Dir:
+        {
+          Folder subFolder;
+          subFolder.path = entryPath;
+          subFolder.root = folder.root;
+          subFolder.depth = folder.depth + 1;
+          folders.push_back(subFolder);
+          break;
+        }
+
+        case FTL::FSStatInfo::File:
+          if ( entry.length() > 9
+              && entry.substr(entry.length()-9, 9) == ".fpm.json" )
+          {
+            Entry result;
+            result.name = entry.substr(0, entry.length()-9);
+            result.path = entryPath;
+            result.root = folder.root;
+            result.depth = folder.depth;
+            entries.push_back(result);
+          }
+          break;
+
+        default:
+          break;
+      }
+    }
+  }
+
+  MutexLocker locker(m_mutex);
+  m_queue.insert(m_queue.end(), folders.begin(), folders.end());
+  m_entries.insert(m_entries.end(), entries.begin(), entries.end());
+  m_busy--;
+  m_condition.wakeAll();
+}
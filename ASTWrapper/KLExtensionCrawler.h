@@ -0,0 +1,67 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLExtensionCrawler__
+#define __ASTWrapper_KLExtensionCrawler__
+
+#include <Threading/Thread.h>
+
+#include <string>
+#include <vector>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+
+    // Walks a set of extension folders with a pool of worker threads
+    // and collects all .fpm.json files found below them. Directory
+    // listings and stats are issued concurrently, which matters on
+    // network mounted FABRIC_EXTS_PATH folders.
+    class KLExtensionCrawler
+    {
+    public:
+
+      struct Entry
+      {
+        std::string name;
+        std::string path;
+        uint32_t root;
+        uint32_t depth;
+
+        // orders by root folder, then depth, then path
+        bool operator < (const Entry & other) const;
+      };
+
+      // returns all extensions found in the given roots, sorted
+      // so that the preferred candidate for a name comes first.
+      static std::vector<Entry> crawl(const std::vector<std::string> & roots, uint32_t numThreads = 0);
+
+    private:
+
+      class Worker;
+
+      struct Folder
+      {
+        std::string path;
+        uint32_t root;
+        uint32_t depth;
+      };
+
+      KLExtensionCrawler();
+
+      bool popFolder(Folder & folder);
+      void processFolder(const Folder & folder);
+
+      Threading::Mutex m_mutex;
+      Threading::Condition m_condition;
+      std::vector<Folder> m_queue;
+      uint32_t m_busy;
+      std::vector<Entry> m_entries;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLExtensionCrawler__
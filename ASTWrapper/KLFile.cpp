@@ -7,10 +7,23 @@
 #include <FTL/Path.h>
 #include <FTL/StrTrim.h>
 #include <limits.h>
+#include <algorithm>
 
 using namespace FabricServices::ASTWrapper;
 
 KLFile::KLFile(const KLExtension* extension, const char * filePath, const char * klCode)
+{
+  init(extension, filePath);
+  m_klCode = klCode;
+}
+
+KLFile::KLFile(const KLExtension* extension, const char * filePath, std::string & klCode)
+{
+  init(extension, filePath);
+  m_klCode.swap(klCode);
+}
+
+void KLFile::init(const KLExtension* extension, const char * filePath)
 {
   m_extension = (KLExtension*)extension;
   m_filePath = filePath;
@@ -21,9 +34,9 @@ KLFile::KLFile(const KLExtension* extension, const char * filePath, const char *
 
   pathSplit = FTL::PathSplit( extension->getFilePath() );
   m_absFilePath = FTL::PathJoin( pathSplit.first, m_filePath );
-  
-  m_klCode = klCode;
+
   m_parsed = false;
+  m_stmtRangesValid = false;
 }
 
 void KLFile::parse()
@@ -32,21 +45,17 @@ void KLFile::parse()
     return;
   m_parsed = true;
 
-  const FabricCore::Client * client = m_extension->getASTManager()->getClient();
-
   try
   {
-    FabricCore::RTVal jsonVal;
-    FabricCore::DFGExec *dfgExec = m_extension->getDFGExec();
-    if ( dfgExec )
-      jsonVal = dfgExec->getJSONAST(m_klCode.c_str(), false);
-    else
-      jsonVal = GetKLJSONAST(*client, m_fileName.c_str(), m_klCode.c_str(), false);
-    std::string jsonStr = jsonVal.getStringCString();
+    std::string jsonStr;
+    jsonStr.swap(m_cachedJSONAST);
+    if(jsonStr.length() == 0)
+      jsonStr = generateJSONAST();
+    const char * jsonAST = jsonStr.c_str();
 
-    // printf("%s\n", jsonStr.c_str());
+    // printf("%s\n", jsonAST);
 
-    FabricCore::Variant variant = FabricCore::Variant::CreateFromJSON(jsonStr.c_str());
+    FabricCore::Variant variant = FabricCore::Variant::CreateFromJSON(jsonAST);
     const FabricCore::Variant * astVariant = variant.getDictValue("ast");
     if(astVariant)
       parseJSON( astVariant );
@@ -59,6 +68,9 @@ void KLFile::parse()
         m_errors.push_back(new KLError(element));
       }
     }
+
+    buildStatementIndex();
+    m_extension->getASTManager()->m_referenceIndex.addFile(this);
   }
   catch(FabricCore::Exception e)
   {
@@ -66,6 +78,26 @@ void KLFile::parse()
   }
 }
 
+std::string KLFile::generateJSONAST() const
+{
+  return generateJSONAST(m_extension->getASTManager()->getClient(), m_extension->getDFGExec(), m_fileName.c_str(), getKLCode());
+}
+
+std::string KLFile::generateJSONAST(const FabricCore::Client * client, FabricCore::DFGExec * dfgExec, const char * fileName, const char * code)
+{
+  FabricCore::RTVal jsonVal;
+  if ( dfgExec )
+    jsonVal = dfgExec->getJSONAST(code, false);
+  else
+    jsonVal = GetKLJSONAST(*client, fileName, code, false);
+  return jsonVal.getStringCString();
+}
+
+void KLFile::setCachedJSONAST(const char * jsonAST)
+{
+  m_cachedJSONAST = jsonAST ? jsonAST : "";
+}
+
 void KLFile::parseJSON( FabricCore::Variant const *astVariant )
 {
   try
@@ -85,7 +117,7 @@ void KLFile::parseJSON( FabricCore::Variant const *astVariant )
       if ( et == "ASTFileGlobal" )
       {
         // setup the global namespace
-        KLNameSpace * e = new KLNameSpace(this, NULL, element);
+        KLNameSpace * e = new(getArena()) KLNameSpace(this, NULL, element);
         m_nameSpaces.push_back(e);
         e->parseJSON( element->getDictValue( "globalList" ) );
       }
@@ -112,9 +144,20 @@ KLFile::~KLFile()
 
 void KLFile::clear()
 {
+  // this only runs the destructors, the memory
+  // is released all at once with the arena
   for(uint32_t i=0;i<m_nameSpaces.size();i++)
     delete(m_nameSpaces[i]);
   m_nameSpaces.clear();
+  m_arena.reset();
+  invalidateStatementIndex();
+  m_extension->getASTManager()->m_referenceIndex.removeFile(this);
+  m_extension->getASTManager()->bumpASTRevision();
+}
+
+KLArena * KLFile::getArena() const
+{
+  return &m_arena;
 }
 
 const KLExtension* KLFile::getExtension() const
@@ -281,38 +324,173 @@ std::vector<const KLError*> KLFile::getErrors() const
 
 const KLStmt * KLFile::getStatementAtCursor(uint32_t line, uint32_t column) const
 {
-  uint32_t minDistance = UINT_MAX;
-  const KLStmt * result = NULL;
+  if(!m_stmtRangesValid)
+    buildStatementIndex();
+  if(m_stmtRanges.size() == 0)
+    return NULL;
+
+  // find the last range starting at or before the cursor
+  StmtRange cursor;
+  cursor.line = line;
+  cursor.column = column;
+  cursor.endLine = 0;
+  cursor.endColumn = 0;
+  cursor.depth = UINT_MAX;
+  std::vector<StmtRange>::const_iterator it =
+    std::upper_bound(m_stmtRanges.begin(), m_stmtRanges.end(), cursor);
+
+  // ranges are nested, so any range containing the cursor
+  // has to be one of the enclosing ranges of that one.
+  int32_t index = int32_t(it - m_stmtRanges.begin()) - 1;
+  while(index >= 0)
+  {
+    const StmtRange & range = m_stmtRanges[index];
+    if(range.contains(line, column))
+      return range.statement;
+    index = range.parent;
+  }
+
+  return NULL;
+}
+
+void KLFile::buildStatementIndex() const
+{
+  m_stmtRanges.clear();
 
-  for(size_t i=0;i<m_nameSpaces.size();i++)
+  std::vector<const KLNameSpace*> nameSpaces = getNameSpaces();
+  for(size_t i=0;i<nameSpaces.size();i++)
   {
-    const KLStmt * statement = m_nameSpaces[i]->getStatementAtCursor(line, column);
-    if(statement)
-    {
-      uint32_t distance = statement->getCursorDistance(line, column);
-      if(distance < minDistance)
-      {
-        result = statement;
-        minDistance = distance;
-      }
-      
-    }
+    std::vector<const KLStmt*> statements;
+    nameSpaces[i]->getTopLevelStatements(statements);
+    for(size_t j=0;j<statements.size();j++)
+      appendStatementRanges(statements[j], m_stmtRanges);
   }
 
-  return result;
+  std::sort(m_stmtRanges.begin(), m_stmtRanges.end());
+
+  std::vector<int32_t> stack;
+  for(size_t i=0;i<m_stmtRanges.size();i++)
+  {
+    while(stack.size() > 0 && !m_stmtRanges[stack.back()].contains(m_stmtRanges[i]))
+      stack.pop_back();
+    m_stmtRanges[i].parent = stack.size() > 0 ? stack.back() : -1;
+    stack.push_back((int32_t)i);
+  }
+
+  m_stmtRangesValid = true;
+}
+
+void KLFile::invalidateReferences() const
+{
+  m_extension->getASTManager()->m_referenceIndex.invalidateFile(this);
+}
+
+void KLFile::invalidateStatementIndex() const
+{
+  m_stmtRanges.clear();
+  m_stmtRangesValid = false;
+}
+
+void KLFile::appendStatementRanges(const KLStmt * statement, std::vector<StmtRange> & ranges)
+{
+  const KLLocation * location = statement->getLocation();
+  if(location)
+  {
+    StmtRange range;
+    range.line = location->getLine();
+    range.column = location->getColumn();
+    range.endLine = location->getEndLine();
+    range.endColumn = location->getEndColumn();
+    range.depth = statement->getDepth();
+    range.parent = -1;
+    range.statement = statement;
+    ranges.push_back(range);
+  }
+
+  for(uint32_t i=0;i<statement->getChildCount();i++)
+    appendStatementRanges(statement->getChild(i), ranges);
+}
+
+bool KLFile::StmtRange::operator < (const StmtRange & other) const
+{
+  // order by start, then the enclosing range first
+  if(line != other.line)
+    return line < other.line;
+  if(column != other.column)
+    return column < other.column;
+  if(endLine != other.endLine)
+    return endLine > other.endLine;
+  if(endColumn != other.endColumn)
+    return endColumn > other.endColumn;
+  return depth < other.depth;
+}
+
+bool KLFile::StmtRange::contains(uint32_t l, uint32_t c) const
+{
+  if(l < line || (l == line && c < column))
+    return false;
+  if(l > endLine || (l == endLine && c > endColumn))
+    return false;
+  return true;
+}
+
+bool KLFile::StmtRange::contains(const StmtRange & other) const
+{
+  return contains(other.line, other.column) && contains(other.endLine, other.endColumn);
 }
 
 bool KLFile::updateKLCode(const char * code)
 {
+  return updateKLCode(code, NULL);
+}
+
+bool KLFile::updateKLCode(const char * code, const char * jsonAST)
+{
+  // the methods other files declare on the types of this file would
+  // be destroyed together with the types, so they are taken off and
+  // pushed onto the new types once the file has been parsed again.
+  std::vector<KLFunction*> foreignDecls;
+  takeForeignDecls(foreignDecls);
+
   clear();
+  for(uint32_t i=0;i<m_errors.size();i++)
+    delete(m_errors[i]);
   m_errors.clear();
 
   m_klCode = code;
+  m_cachedJSONAST = jsonAST ? jsonAST : "";
   m_parsed = false;
   parse();
 
-  if(!hasErrors())
-    m_extension->getASTManager()->onFileParsed(this);
+  for(size_t i=0;i<foreignDecls.size();i++)
+    ((KLNameSpace*)foreignDecls[i]->getNameSpace())->reattachForeignDecl(foreignDecls[i]);
+
+  // clients are notified per file even if it has errors, the decls
+  // which could be parsed replace the previous ones of this file only.
+  m_extension->getASTManager()->onFileParsed(this);
 
   return hasErrors();
 }
+
+void KLFile::takeForeignDecls(std::vector<KLFunction*> & decls)
+{
+  std::vector<const KLType*> types = getTypes();
+  for(size_t i=0;i<types.size();i++)
+  {
+    for(uint32_t j=0;j<types[i]->getMethodCount();j++)
+    {
+      const KLMethod * method = types[i]->getMethod(j);
+      if(method->getKLFile() != this)
+        decls.push_back((KLFunction*)method);
+    }
+    for(uint32_t j=0;j<types[i]->getTypeOpCount();j++)
+    {
+      const KLTypeOp * typeOp = types[i]->getTypeOp(j);
+      if(typeOp->getKLFile() != this)
+        decls.push_back((KLFunction*)typeOp);
+    }
+  }
+
+  for(size_t i=0;i<decls.size();i++)
+    ((KLNameSpace*)decls[i]->getNameSpace())->takeForeignDecl(decls[i]);
+}
@@ -22,6 +22,7 @@ namespace FabricServices
       friend class KLExtension;
       friend class KLASTManager;
       friend class KLNameSpace;
+      friend class KLSymbolDatabase;
       
     public:
 
@@ -53,26 +54,75 @@ namespace FabricServices
 
       virtual const KLStmt * getStatementAtCursor(uint32_t line, uint32_t column) const;
       virtual bool updateKLCode(const char * code);
+      // updates the code using compiler output which was generated
+      // elsewhere, for example on a worker thread
+      virtual bool updateKLCode(const char * code, const char * jsonAST);
+
+      // runs the KL compiler on the given code and returns its JSON output.
+      // this doesn't touch any AST state and may be called from any thread.
+      static std::string generateJSONAST(const FabricCore::Client * client, FabricCore::DFGExec * dfgExec, const char * fileName, const char * code);
+
+      // the arena all decls and statements of this file are placed in
+      KLArena * getArena() const;
 
     protected:
       
       KLFile(const KLExtension* extension, const char * filePath, const char * klCode);
+      // takes over the code without a copy, klCode is left empty
+      KLFile(const KLExtension* extension, const char * filePath, std::string & klCode);
       void parseJSON( FabricCore::Variant const *astVariant );
+      void init(const KLExtension* extension, const char * filePath);
       void parse();
       void clear();
+      // runs the KL compiler on the code and returns its JSON output
+      std::string generateJSONAST() const;
+      // uses a copy of previously generated compiler output for the next parse
+      void setCachedJSONAST(const char * jsonAST);
 
       KLExtension* getExtensionMutable() const;
 
+      void buildStatementIndex() const;
+      void invalidateStatementIndex() const;
+      void invalidateReferences() const;
+
     private:
+
+      // takes the methods and type ops other files declared
+      // on the types of this file off the types
+      void takeForeignDecls(std::vector<KLFunction*> & decls);
+
+      // flattened range of a single statement, sorted by start position.
+      // parent is the index of the closest enclosing range or -1.
+      struct StmtRange
+      {
+        uint32_t line;
+        uint32_t column;
+        uint32_t endLine;
+        uint32_t endColumn;
+        uint32_t depth;
+        int32_t parent;
+        const KLStmt * statement;
+
+        bool operator < (const StmtRange & other) const;
+        bool contains(uint32_t l, uint32_t c) const;
+        bool contains(const StmtRange & other) const;
+      };
+
+      static void appendStatementRanges(const KLStmt * statement, std::vector<StmtRange> & ranges);
+
       bool m_parsed;
       KLExtension* m_extension;
       std::string m_filePath;
       std::string m_fileName;
       std::string m_absFilePath;
       std::string m_klCode;
+      std::string m_cachedJSONAST;
+      mutable KLArena m_arena;
       
       std::vector<const KLNameSpace*> m_nameSpaces;
       std::vector<const KLError*> m_errors;
+      mutable std::vector<StmtRange> m_stmtRanges;
+      mutable bool m_stmtRangesValid;
     };
 
   };
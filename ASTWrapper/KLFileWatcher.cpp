@@ -0,0 +1,216 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLFileWatcher.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+# include <unistd.h>
+#endif
+
+#if defined(__linux__)
+# include <sys/inotify.h>
+# include <poll.h>
+#endif
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::Threading;
+
+// how long the thread sleeps between checks for changes or a stop request
+#define KLFILEWATCHER_POLL_INTERVAL 100
+// the modification time polling fallback only stats the files this often
+#define KLFILEWATCHER_STAT_INTERVAL 500
+
+static std::string KLFileWatcherFolder(const std::string & filePath)
+{
+  size_t pos = filePath.find_last_of("/\\");
+  if(pos == std::string::npos)
+    return ".";
+  return filePath.substr(0, pos);
+}
+
+static int64_t KLFileWatcherModificationTime(const std::string & filePath)
+{
+  struct stat st;
+  if(stat(filePath.c_str(), &st) != 0)
+    return -1;
+  return (int64_t)st.st_mtime;
+}
+
+KLFileWatcher::KLFileWatcher(uint32_t debounceMilliseconds)
+{
+  m_debounce = debounceMilliseconds;
+  m_stop = false;
+#if defined(__linux__)
+  m_inotify = inotify_init();
+#else
+  m_inotify = -1;
+#endif
+}
+
+KLFileWatcher::~KLFileWatcher()
+{
+  stop();
+#if defined(__linux__)
+  if(m_inotify >= 0)
+    close(m_inotify);
+#endif
+}
+
+void KLFileWatcher::watchFile(const std::string & filePath)
+{
+  MutexLocker locker(m_mutex);
+  if(m_files.find(filePath) != m_files.end())
+    return;
+
+  m_files.insert(std::pair<std::string, int64_t>(filePath, KLFileWatcherModificationTime(filePath)));
+
+#if defined(__linux__)
+  if(m_inotify < 0)
+    return;
+
+  std::string folder = KLFileWatcherFolder(filePath);
+  if(m_folderWatches.find(folder) != m_folderWatches.end())
+    return;
+
+  int wd = inotify_add_watch(m_inotify, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if(wd < 0)
+    return;
+  m_folderWatches.insert(std::pair<std::string, int>(folder, wd));
+  m_watchFolders.insert(std::pair<int, std::string>(wd, folder));
+#endif
+}
+
+void KLFileWatcher::unwatchFile(const std::string & filePath)
+{
+  MutexLocker locker(m_mutex);
+  if(m_files.erase(filePath) == 0)
+    return;
+  m_pending.erase(filePath);
+
+#if defined(__linux__)
+  std::string folder = KLFileWatcherFolder(filePath);
+  std::map<std::string, int>::iterator it = m_folderWatches.find(folder);
+  if(it == m_folderWatches.end())
+    return;
+
+  // keep the folder watched as long as other files in it are
+  for(std::map<std::string, int64_t>::const_iterator f = m_files.begin(); f != m_files.end(); f++)
+  {
+    if(KLFileWatcherFolder(f->first) == folder)
+      return;
+  }
+
+  inotify_rm_watch(m_inotify, it->second);
+  m_watchFolders.erase(it->second);
+  m_folderWatches.erase(it);
+#endif
+}
+
+void KLFileWatcher::stop()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+  }
+  join();
+
+  MutexLocker locker(m_mutex);
+  m_stop = false;
+}
+
+std::vector<std::string> KLFileWatcher::takeChangedFiles()
+{
+  std::vector<std::string> result;
+  uint64_t now = getMilliseconds();
+
+  MutexLocker locker(m_mutex);
+  std::map<std::string, uint64_t>::iterator it = m_pending.begin();
+  while(it != m_pending.end())
+  {
+    if(now - it->second >= m_debounce)
+    {
+      result.push_back(it->first);
+      m_pending.erase(it++);
+    }
+    else
+      it++;
+  }
+  return result;
+}
+
+void KLFileWatcher::recordChange(const std::string & filePath)
+{
+  // the caller holds the mutex. every new change restarts the debounce window.
+  m_pending[filePath] = getMilliseconds();
+}
+
+void KLFileWatcher::pollModificationTimes()
+{
+  MutexLocker locker(m_mutex);
+  for(std::map<std::string, int64_t>::iterator it = m_files.begin(); it != m_files.end(); it++)
+  {
+    int64_t modificationTime = KLFileWatcherModificationTime(it->first);
+    if(modificationTime < 0 || modificationTime == it->second)
+      continue;
+    it->second = modificationTime;
+    recordChange(it->first);
+  }
+}
+
+void KLFileWatcher::run()
+{
+  uint64_t lastStat = getMilliseconds();
+
+  for(;;)
+  {
+    {
+      MutexLocker locker(m_mutex);
+      if(m_stop)
+        break;
+    }
+
+#if defined(__linux__)
+    if(m_inotify >= 0)
+    {
+      struct pollfd pfd;
+      pfd.fd = m_inotify;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if(poll(&pfd, 1, KLFILEWATCHER_POLL_INTERVAL) <= 0)
+        continue;
+
+      char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+      ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+      if(length <= 0)
+        continue;
+
+      MutexLocker locker(m_mutex);
+      for(char * ptr = buffer; ptr < buffer + length; )
+      {
+        const struct inotify_event * event = (const struct inotify_event *)ptr;
+        ptr += sizeof(struct inotify_event) + event->len;
+        if(event->len == 0)
+          continue;
+
+        std::map<int, std::string>::const_iterator it = m_watchFolders.find(event->wd);
+        if(it == m_watchFolders.end())
+          continue;
+
+        std::string filePath = it->second + "/" + event->name;
+        if(m_files.find(filePath) != m_files.end())
+          recordChange(filePath);
+      }
+      continue;
+    }
+#endif
+
+    Thread::sleep(KLFILEWATCHER_POLL_INTERVAL);
+    uint64_t now = getMilliseconds();
+    if(now - lastStat < KLFILEWATCHER_STAT_INTERVAL)
+      continue;
+    lastStat = now;
+    pollModificationTimes();
+  }
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLFileWatcher__
+#define __ASTWrapper_KLFileWatcher__
+
+#include <Threading/Thread.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+
+    // Watches a set of files on disk from a background thread. On Linux
+    // this uses inotify on the containing folders (so that editors which
+    // save through a rename are caught as well), elsewhere the files'
+    // modification times are polled. Changes are debounced, a file is
+    // only reported once it has been quiet for the debounce interval.
+    class KLFileWatcher : public Threading::Thread
+    {
+    public:
+
+      KLFileWatcher(uint32_t debounceMilliseconds = 250);
+      virtual ~KLFileWatcher();
+
+      void watchFile(const std::string & filePath);
+      void unwatchFile(const std::string & filePath);
+
+      void stop();
+
+      // returns the files which changed and have settled since
+      // the last call. safe to call from any thread.
+      std::vector<std::string> takeChangedFiles();
+
+    protected:
+
+      virtual void run();
+
+    private:
+
+      void recordChange(const std::string & filePath);
+      void pollModificationTimes();
+
+      uint32_t m_debounce;
+      bool m_stop;
+      Threading::Mutex m_mutex;
+      std::map<std::string, int64_t> m_files;
+      std::map<std::string, uint64_t> m_pending;
+
+      // inotify descriptor and watches per folder (linux only)
+      int m_inotify;
+      std::map<std::string, int> m_folderWatches;
+      std::map<int, std::string> m_watchFolders;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLFileWatcher__
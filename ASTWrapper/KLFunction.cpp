@@ -8,6 +8,8 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <algorithm>
+#include <limits.h>
 
 using namespace FabricServices::ASTWrapper;
 
@@ -41,7 +43,7 @@ KLFunction::KLFunction(const KLFile* klFile, const KLNameSpace * nameSpace, JSON
   {
     for(uint32_t i=0;i<params->getArraySize();i++)
     {
-      KLParameter * param = new KLParameter(klFile, nameSpace, params->getArrayElement(i));
+      KLParameter * param = new(getArena()) KLParameter(klFile, nameSpace, params->getArrayElement(i));
       m_params.push_back(param);
     }
   }
@@ -52,6 +54,7 @@ KLFunction::KLFunction(const KLFile* klFile, const KLNameSpace * nameSpace, JSON
   else
     m_body = NULL;
 
+  buildScopeTable();
 }
 
 KLFunction::~KLFunction()
@@ -222,3 +225,110 @@ std::string KLFunction::getLabel() const
   return m_label;
 }
 
+
+uint32_t KLFunction::getLocalVariableCount() const
+{
+  return (uint32_t)m_localVariables.size();
+}
+
+const KLLocalVariable & KLFunction::getLocalVariable(uint32_t index) const
+{
+  return m_localVariables[index];
+}
+
+static bool KLLocalVariableDeclaredBefore(const KLLocalVariable & a, const KLLocalVariable & b)
+{
+  if(a.line != b.line)
+    return a.line < b.line;
+  return a.column < b.column;
+}
+
+uint32_t KLFunction::getLocalVariablesDeclaredBefore(uint32_t line, uint32_t column) const
+{
+  KLLocalVariable cursor;
+  cursor.line = line;
+  cursor.column = column;
+  std::vector<KLLocalVariable>::const_iterator it =
+    std::upper_bound(m_localVariables.begin(), m_localVariables.end(), cursor, KLLocalVariableDeclaredBefore);
+  return (uint32_t)(it - m_localVariables.begin());
+}
+
+static void KLLocalVariableSetScope(KLLocalVariable & variable, const KLLocation * location)
+{
+  if(location)
+  {
+    variable.scopeLine = location->getLine();
+    variable.scopeColumn = location->getColumn();
+    variable.scopeEndLine = location->getEndLine();
+    variable.scopeEndColumn = location->getEndColumn();
+  }
+  else
+  {
+    variable.scopeLine = 0;
+    variable.scopeColumn = 0;
+    variable.scopeEndLine = UINT_MAX;
+    variable.scopeEndColumn = UINT_MAX;
+  }
+}
+
+void KLFunction::buildScopeTable()
+{
+  m_localVariables.clear();
+
+  // the parameters are visible throughout the function
+  const KLLocation * location = getLocation();
+  for(size_t i=0;i<m_params.size();i++)
+  {
+    KLLocalVariable variable;
+    variable.name = m_params[i]->getName();
+    variable.type = m_params[i]->getType();
+    variable.isParameter = true;
+    variable.line = location ? location->getLine() : 0;
+    variable.column = location ? location->getColumn() : 0;
+    KLLocalVariableSetScope(variable, location);
+    m_localVariables.push_back(variable);
+  }
+
+  if(m_body)
+    appendLocalVariables(m_body);
+
+  std::stable_sort(m_localVariables.begin(), m_localVariables.end(), KLLocalVariableDeclaredBefore);
+}
+
+void KLFunction::appendLocalVariables(const KLStmt * statement)
+{
+  if(statement->isOfDeclType(KLDeclType_VarDeclStmt))
+  {
+    // a variable lives in the statement it is declared in
+    const KLVarDeclStmt * varDecl = (const KLVarDeclStmt *)statement;
+    const KLLocation * location = varDecl->getLocation();
+    const KLStmt * parent = varDecl->getParent();
+
+    KLLocalVariable variable;
+    variable.type = varDecl->getBaseType();
+    variable.isParameter = false;
+    variable.line = location ? location->getLine() : 0;
+    variable.column = location ? location->getColumn() : 0;
+    KLLocalVariableSetScope(variable, parent ? parent->getLocation() : NULL);
+    for(uint32_t i=0;i<varDecl->getCount();i++)
+    {
+      variable.name = varDecl->getName(i);
+      variable.arrayModifier = varDecl->getArrayModifier(i);
+      m_localVariables.push_back(variable);
+    }
+  }
+
+  for(uint32_t i=0;i<statement->getChildCount();i++)
+    appendLocalVariables(statement->getChild(i));
+}
+
+bool KLLocalVariable::isVisibleAt(uint32_t line, uint32_t column) const
+{
+  if(scopeLine > line || scopeEndLine < line)
+    return false;
+  if(scopeLine == line && scopeColumn > column)
+    return false;
+  if(scopeEndLine == line && scopeEndColumn < column)
+    return false;
+  return true;
+}
@@ -23,6 +23,25 @@ namespace FabricServices
   namespace ASTWrapper
   {
 
+    // a parameter or local variable of a function, together with the
+    // position of its declaration and the range of the enclosing scope.
+    struct KLLocalVariable
+    {
+      std::string name;
+      // the base type for variables, the full type for parameters
+      std::string type;
+      std::string arrayModifier;
+      bool isParameter;
+      uint32_t line;
+      uint32_t column;
+      uint32_t scopeLine;
+      uint32_t scopeColumn;
+      uint32_t scopeEndLine;
+      uint32_t scopeEndColumn;
+
+      bool isVisibleAt(uint32_t line, uint32_t column) const;
+    };
+
     class KLFunction : public KLStmt
     {
       friend class KLNameSpace;
@@ -52,11 +71,23 @@ namespace FabricServices
       virtual std::string getKLCode(bool includeReturnType = true, bool includeKeyWord = true, bool includePrefix = true, bool includeName = true) const;
       virtual std::string getLabel() const;
 
+      // the scope table of all parameters and local variables, sorted by
+      // the position of their declaration. it is built once during parse.
+      uint32_t getLocalVariableCount() const;
+      const KLLocalVariable & getLocalVariable(uint32_t index) const;
+      // returns the number of leading entries of the scope table declared
+      // at or before the cursor. the variables visible at the cursor are
+      // the ones among those for which isVisibleAt returns true.
+      uint32_t getLocalVariablesDeclaredBefore(uint32_t line, uint32_t column) const;
+
     protected:
 
       KLFunction(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData data);
 
     private:
+
+      void buildScopeTable();
+      void appendLocalVariables(const KLStmt * statement);
       
       std::string m_name;
       int m_flags;
@@ -66,6 +97,7 @@ namespace FabricServices
       std::string m_symbolName;
       std::vector<KLParameter*> m_params;
       KLCompoundStmt * m_body;
+      std::vector<KLLocalVariable> m_localVariables;
     };
 
   };
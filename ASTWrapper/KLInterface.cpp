@@ -14,7 +14,7 @@ KLInterface::KLInterface(const KLFile* klFile, const KLNameSpace * nameSpace, JS
   {
     for(uint32_t i=0;i<members->getArraySize();i++)
     {
-      KLMethod * m = new KLMethod(klFile, nameSpace, members->getArrayElement(i), getName());
+      KLMethod * m = new(getArena()) KLMethod(klFile, nameSpace, members->getArrayElement(i), getName());
       pushMethod(m);
     }
   }
@@ -16,6 +16,20 @@ KLLocation::~KLLocation()
 {
 }
 
+void * KLLocation::operator new(size_t size, KLArena * arena)
+{
+  return arena->allocate(size);
+}
+
+void KLLocation::operator delete(void * ptr, KLArena * arena)
+{
+}
+
+void KLLocation::operator delete(void * ptr)
+{
+  // the memory is reclaimed with the arena of the KLFile
+}
+
 uint32_t KLLocation::getLine() const
 {
   return m_line;
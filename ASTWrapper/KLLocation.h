@@ -24,6 +24,10 @@ namespace FabricServices
       uint32_t getEndLine() const;
       uint32_t getEndColumn() const;
 
+      static void * operator new(size_t size, KLArena * arena);
+      static void operator delete(void * ptr, KLArena * arena);
+      static void operator delete(void * ptr);
+
     protected:
       
       KLLocation(JSONData data);
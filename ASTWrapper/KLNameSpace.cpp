@@ -7,6 +7,7 @@
 #include <FTL/Path.h>
 #include <FTL/StrTrim.h>
 #include <limits.h>
+#include <set>
 
 using namespace FabricServices::ASTWrapper;
 
@@ -42,6 +43,18 @@ const char * KLNameSpace::getName() const
 
 void KLNameSpace::clear()
 {
+  for(size_t i=0;i<m_foreignDecls.size();i++)
+  {
+    const KLType * klType = m_foreignDecls[i].first;
+    KLFunction * decl = m_foreignDecls[i].second;
+    if(decl->isOfDeclType(KLDeclType_TypeOp))
+      klType->removeTypeOp((const KLTypeOp*)decl);
+    else
+      klType->removeMethod((const KLMethod*)decl);
+    delete(decl);
+  }
+  m_foreignDecls.clear();
+
   for(uint32_t i=0;i<m_requires.size();i++)
     delete(m_requires[i]);
   for(uint32_t i=0;i<m_nameSpaces.size();i++)
@@ -62,9 +75,94 @@ void KLNameSpace::clear()
   m_constants.clear();
   m_types.clear();
   m_functions.clear();
+  m_methods.clear();
   m_operators.clear();
 }
 
+void KLNameSpace::trackForeignDecl(const KLType * klType, KLFunction * decl)
+{
+  if(klType->getKLFile() == getKLFile())
+    return;
+  m_foreignDecls.push_back(std::pair<const KLType*, KLFunction*>(klType, decl));
+}
+
+void KLNameSpace::detachForeignDecl(const KLFunction * decl)
+{
+  for(size_t i=0;i<m_foreignDecls.size();i++)
+  {
+    if(m_foreignDecls[i].second == decl)
+    {
+      m_foreignDecls.erase(m_foreignDecls.begin() + i);
+      break;
+    }
+  }
+  for(size_t i=0;i<m_methods.size();i++)
+  {
+    if(m_methods[i] == decl)
+    {
+      m_methods.erase(m_methods.begin() + i);
+      break;
+    }
+  }
+  getKLFile()->invalidateStatementIndex();
+  getKLFile()->invalidateReferences();
+}
+
+void KLNameSpace::takeForeignDecl(KLFunction * decl)
+{
+  for(size_t i=0;i<m_foreignDecls.size();i++)
+  {
+    if(m_foreignDecls[i].second != decl)
+      continue;
+    const KLType * klType = m_foreignDecls[i].first;
+    if(decl->isOfDeclType(KLDeclType_TypeOp))
+      klType->removeTypeOp((const KLTypeOp*)decl);
+    else
+      klType->removeMethod((const KLMethod*)decl);
+    m_foreignDecls.erase(m_foreignDecls.begin() + i);
+    break;
+  }
+}
+
+void KLNameSpace::reattachForeignDecl(KLFunction * decl)
+{
+  bool isTypeOp = decl->isOfDeclType(KLDeclType_TypeOp);
+  std::string thisType;
+  if(isTypeOp)
+    thisType = ((KLTypeOp*)decl)->getLhs();
+  else
+    thisType = ((KLMethod*)decl)->getThisType();
+
+  const KLType * klType = getExtension()->getASTManager()->getKLTypeByName(thisType.c_str(), decl);
+  if(klType)
+  {
+    bool pushed;
+    if(isTypeOp)
+      pushed = klType->pushTypeOp((KLTypeOp*)decl);
+    else
+      pushed = klType->pushMethod((KLMethod*)decl);
+    if(pushed)
+    {
+      trackForeignDecl(klType, decl);
+      return;
+    }
+  }
+
+  // the type is gone, so the decl is kept
+  // as a function just like parseJSON does
+  for(size_t i=0;i<m_methods.size();i++)
+  {
+    if(m_methods[i] == decl)
+    {
+      m_methods.erase(m_methods.begin() + i);
+      break;
+    }
+  }
+  m_functions.push_back(decl);
+  getKLFile()->invalidateStatementIndex();
+  getKLFile()->invalidateReferences();
+}
+
 void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
 {
   try
@@ -86,7 +184,7 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
 
       if(et == "RequireGlobal")
       {
-        KLRequire * e = new KLRequire(getKLFile(), this, element);
+        KLRequire * e = new(getArena()) KLRequire(getKLFile(), this, element);
         m_requires.push_back(e);
 
         // ensure to parse extensions in the right order,
@@ -105,7 +203,7 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
       }
       else if ( et == "ASTNamespaceGlobal" )
       {
-        KLNameSpace * e = new KLNameSpace(getKLFile(), this, element);
+        KLNameSpace * e = new(getArena()) KLNameSpace(getKLFile(), this, element);
         m_nameSpaces.push_back(e);
         e->parseJSON( element->getDictValue( "globalList" ) );
       }
@@ -115,25 +213,28 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
       }
       else if(et == "Alias")
       {
-        KLAlias * e = new KLAlias(getKLFile(), this, element);
+        KLAlias * e = new(getArena()) KLAlias(getKLFile(), this, element);
         m_aliases.push_back(e);
       }
       else if(et == "GlobalConstDecl")
       {
-        KLConstant * e = new KLConstant(getKLFile(), this, element);
+        KLConstant * e = new(getArena()) KLConstant(getKLFile(), this, element);
         m_constants.push_back(e);
       }
       else if(et == "Function")
       {
-        KLFunction * e = new KLFunction(getKLFile(), this, element);
+        KLFunction * e = new(getArena()) KLFunction(getKLFile(), this, element);
         const KLType * klType = getExtension()->getASTManager()->getKLTypeByName(e->getName().c_str(), e);
         if(klType)
         {
-          KLMethod * m = new KLMethod(getKLFile(), this, element, e->getName());
+          KLMethod * m = new(getArena()) KLMethod(getKLFile(), this, element, e->getName());
           if(!klType->pushMethod(m))
             m_functions.push_back(m);
           else
+          {
             m_methods.push_back(m);
+            trackForeignDecl(klType, m);
+          }
           delete(e);
         }
         else
@@ -143,12 +244,12 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
       }
       else if(et == "Operator")
       {
-        KLOperator * e = new KLOperator(getKLFile(), this, element);
+        KLOperator * e = new(getArena()) KLOperator(getKLFile(), this, element);
         m_operators.push_back(e);
       }
       else if(et == "ASTStructDecl")
       {
-        KLStruct * e = new KLStruct(getKLFile(), this, element);
+        KLStruct * e = new(getArena()) KLStruct(getKLFile(), this, element);
         if(e->isForwardDecl())
         {
           getKLFile()->getExtensionMutable()->storeForwardDeclComments(e);
@@ -162,7 +263,7 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
       }
       else if(et == "MethodOpImpl")
       {
-        KLMethod * e = new KLMethod(getKLFile(), this, element);
+        KLMethod * e = new(getArena()) KLMethod(getKLFile(), this, element);
         std::string thisType = e->getThisType();
 
         const KLType * klType = getExtension()->getASTManager()->getKLTypeByName(thisType.c_str(), e);
@@ -171,7 +272,10 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
           if(!klType->pushMethod(e))
             m_functions.push_back(e);
           else
+          {
             m_methods.push_back(e);
+            trackForeignDecl(klType, e);
+          }
         }
         else
         {
@@ -183,19 +287,21 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
         KLFunction function(getKLFile(), this, element);
         std::string thisType = function.getName();
         FTL::StrTrimLeft<'~'>( thisType );
-        KLMethod * e = new KLMethod(getKLFile(), this, element, thisType);
+        KLMethod * e = new(getArena()) KLMethod(getKLFile(), this, element, thisType);
         const KLType * klType = getExtension()->getASTManager()->getKLTypeByName(thisType.c_str(), e);
         if(klType)
         {
           if(!klType->pushMethod(e))
             m_functions.push_back(e);
+          else
+            trackForeignDecl(klType, e);
         }
         else
           m_functions.push_back(e);
       }
       else if(et == "ASTInterfaceDecl")
       {
-        KLInterface * e = new KLInterface(getKLFile(), this, element);
+        KLInterface * e = new(getArena()) KLInterface(getKLFile(), this, element);
         if(e->isForwardDecl())
         {
           getKLFile()->getExtensionMutable()->storeForwardDeclComments(e);
@@ -209,7 +315,7 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
       }
       else if(et == "ASTObjectDecl")
       {
-        KLObject * e = new KLObject(getKLFile(), this, element);
+        KLObject * e = new(getArena()) KLObject(getKLFile(), this, element);
         if(e->isForwardDecl())
         {
           getKLFile()->getExtensionMutable()->storeForwardDeclComments(e);
@@ -226,12 +332,15 @@ void KLNameSpace::parseJSON( FabricCore::Variant const *astVariant )
         et == "BinOpImpl" ||
         et == "ASTUniOpDecl")
       {
-        KLTypeOp * e = new KLTypeOp(getKLFile(), this, element);
+        KLTypeOp * e = new(getArena()) KLTypeOp(getKLFile(), this, element);
 
         std::string thisType = e->getLhs();
         const KLType * klType = getExtension()->getASTManager()->getKLTypeByName(thisType.c_str(), e);
         if(klType)
-          klType->pushTypeOp(e);
+        {
+          if(klType->pushTypeOp(e))
+            trackForeignDecl(klType, e);
+        }
         else
           m_functions.push_back(e);
       }
@@ -381,71 +490,63 @@ std::vector<const KLObject*> KLNameSpace::getObjects() const
   return result;
 }
 
-const KLStmt * KLNameSpace::getStatementAtCursor(uint32_t line, uint32_t column) const
+void KLNameSpace::getTopLevelStatements(std::vector<const KLStmt*> & result) const
 {
-  uint32_t minDistance = UINT_MAX;
-  const KLStmt * result = NULL;
-
+  // collect all functions, methods and type ops declared
+  // in this namespace, including the ones stored on types.
+  std::set<const KLStmt*> visited;
   for(size_t i=0;i<m_functions.size();i++)
   {
-    const KLStmt * statement = m_functions[i]->getStatementAtCursor(line, column);
-    if(statement)
-    {
-      uint32_t distance = statement->getCursorDistance(line, column);
-      if(distance < minDistance)
-      {
-        result = statement;
-        minDistance = distance;
-      }
-      
-    }
+    if(visited.insert(m_functions[i]).second)
+      result.push_back(m_functions[i]);
   }
-
   for(size_t i=0;i<m_operators.size();i++)
   {
-    const KLStmt * statement = m_operators[i]->getStatementAtCursor(line, column);
-    if(statement)
-    {
-      uint32_t distance = statement->getCursorDistance(line, column);
-      if(distance < minDistance)
-      {
-        result = statement;
-        minDistance = distance;
-      }
-      
-    }
+    if(visited.insert(m_operators[i]).second)
+      result.push_back(m_operators[i]);
+  }
+  for(size_t i=0;i<m_methods.size();i++)
+  {
+    if(visited.insert(m_methods[i]).second)
+      result.push_back(m_methods[i]);
+  }
+  for(size_t i=0;i<m_foreignDecls.size();i++)
+  {
+    if(visited.insert(m_foreignDecls[i].second).second)
+      result.push_back(m_foreignDecls[i].second);
   }
-
   for(size_t i=0;i<m_types.size();i++)
   {
     for(uint32_t j=0;j<m_types[i]->getMethodCount();j++)
     {
-      const KLStmt * statement = m_types[i]->getMethod(j)->getStatementAtCursor(line, column);
-      if(statement)
-      {
-        uint32_t distance = statement->getCursorDistance(line, column);
-        if(distance < minDistance)
-        {
-          result = statement;
-          minDistance = distance;
-        }
-      }
+      const KLStmt * statement = m_types[i]->getMethod(j);
+      if(statement->getKLFile() != getKLFile())
+        continue;
+      if(visited.insert(statement).second)
+        result.push_back(statement);
     }
-
     for(uint32_t j=0;j<m_types[i]->getTypeOpCount();j++)
     {
-      const KLStmt * statement = m_types[i]->getTypeOp(j)->getStatementAtCursor(line, column);
-      if(statement)
-      {
-        uint32_t distance = statement->getCursorDistance(line, column);
-        if(distance < minDistance)
-        {
-          result = statement;
-          minDistance = distance;
-        }
-      }
+      const KLStmt * statement = m_types[i]->getTypeOp(j);
+      if(statement->getKLFile() != getKLFile())
+        continue;
+      if(visited.insert(statement).second)
+        result.push_back(statement);
     }
   }
+}
 
-  return result;
+const KLStmt * KLNameSpace::getStatementAtCursor(uint32_t line, uint32_t column) const
+{
+  std::vector<const KLStmt*> statements;
+  getTopLevelStatements(statements);
+
+  for(size_t i=0;i<statements.size();i++)
+  {
+    const KLStmt * statement = statements[i]->getStatementAtCursor(line, column);
+    if(statement)
+      return statement;
+  }
+
+  return NULL;
 }
@@ -20,6 +20,7 @@ namespace FabricServices
     class KLNameSpace : public KLDeclContainer, public KLStmtSearch, public KLCommented
     {
       friend class KLFile;
+      friend class KLType;
       
     public:
 
@@ -46,6 +47,7 @@ namespace FabricServices
       virtual std::vector<const KLObject*> getObjects() const;
 
       virtual const KLStmt * getStatementAtCursor(uint32_t line, uint32_t column) const;
+      void getTopLevelStatements(std::vector<const KLStmt*> & result) const;
 
     protected:
       
@@ -54,6 +56,16 @@ namespace FabricServices
 
       void parseJSON( FabricCore::Variant const *astVariant );
 
+      // methods and type ops pushed into a type of another KLFile
+      // live in our arena, so we need to take them back on clear.
+      void trackForeignDecl(const KLType * klType, KLFunction * decl);
+      void detachForeignDecl(const KLFunction * decl);
+      // takes a decl off its type without destroying it, for example
+      // while the type's file is parsed again, and pushes it onto the
+      // type of the same name afterwards.
+      void takeForeignDecl(KLFunction * decl);
+      void reattachForeignDecl(KLFunction * decl);
+
       std::vector<const KLRequire*> m_requires;
       std::vector<const KLNameSpace*> m_nameSpaces;
       std::vector<const KLAlias*> m_aliases;
@@ -66,6 +78,7 @@ namespace FabricServices
     private:
 
       std::string m_name;
+      std::vector< std::pair<const KLType*, KLFunction*> > m_foreignDecls;
     };
 
   };
@@ -42,6 +42,9 @@ const char * KLObject::getKLType() const
 
 std::vector<const KLType*> KLObject::getParents() const
 {
+  if(validateCaches() && m_parentsCached)
+    return m_parentsCache;
+
   std::vector<const KLType*> parents; 
   for(uint32_t i=0;i<m_parentsAndInterfaces.size();i++)
   {
@@ -51,5 +54,8 @@ std::vector<const KLType*> KLObject::getParents() const
       parents.push_back(parent);
     }
   }
+
+  m_parentsCache = parents;
+  m_parentsCached = true;
   return parents;
 }
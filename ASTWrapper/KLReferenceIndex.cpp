@@ -0,0 +1,167 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLReferenceIndex.h"
+#include "KLFile.h"
+#include "KLMethod.h"
+
+using namespace FabricServices::ASTWrapper;
+
+static std::string KLReferenceIndexTypeName(const std::string & type)
+{
+  // drop array modifiers, ie. Vec3[] or Vec3<>
+  size_t pos = type.find_first_of("[<");
+  if(pos == std::string::npos)
+    return type;
+  return type.substr(0, pos);
+}
+
+KLReferenceIndex::KLReferenceIndex()
+{
+}
+
+std::vector<KLReference> KLReferenceIndex::getReferences(const char * name) const
+{
+  update();
+  std::map<std::string, std::vector<KLReference> >::const_iterator it = m_references.find(name);
+  if(it == m_references.end())
+    return std::vector<KLReference>();
+  return it->second;
+}
+
+std::vector<KLReference> KLReferenceIndex::getReferences(const KLType * type) const
+{
+  return getReferences(type->getName().c_str());
+}
+
+std::vector<KLReference> KLReferenceIndex::getReferences(const KLFunction * function) const
+{
+  return getReferences(function->getName().c_str());
+}
+
+uint32_t KLReferenceIndex::getReferenceCount(const char * name) const
+{
+  update();
+  std::map<std::string, std::vector<KLReference> >::const_iterator it = m_references.find(name);
+  if(it == m_references.end())
+    return 0;
+  return it->second.size();
+}
+
+void KLReferenceIndex::addFile(const KLFile * file)
+{
+  removeFile(file);
+
+  std::vector<const KLNameSpace*> nameSpaces = file->getNameSpaces();
+  for(size_t i=0;i<nameSpaces.size();i++)
+  {
+    std::vector<const KLType*> types = nameSpaces[i]->getTypes();
+    for(size_t j=0;j<types.size();j++)
+    {
+      if(!types[j]->isOfDeclType(KLDeclType_Struct))
+        continue;
+      const KLStruct * klStruct = (const KLStruct *)types[j];
+      for(uint32_t k=0;k<klStruct->getMemberCount(false);k++)
+      {
+        const KLMember * member = klStruct->getMember(k, false);
+        addReference(member->getTypeNoArray(), KLReferenceKind_MemberType, member, file);
+      }
+    }
+
+    std::vector<const KLStmt*> statements;
+    nameSpaces[i]->getTopLevelStatements(statements);
+    for(size_t j=0;j<statements.size();j++)
+    {
+      if(!statements[j]->isOfDeclType(KLDeclType_Function))
+        continue;
+
+      const KLFunction * function = (const KLFunction *)statements[j];
+      addReference(function->getReturnType(), KLReferenceKind_ReturnType, function, file);
+      for(uint32_t k=0;k<function->getParameterCount();k++)
+      {
+        const KLParameter * parameter = function->getParameter(k);
+        addReference(parameter->getTypeNoArray(), KLReferenceKind_ParameterType, parameter, file);
+      }
+      if(function->isOfDeclType(KLDeclType_Method))
+        addReference(((const KLMethod *)function)->getThisType(), KLReferenceKind_ThisType, function, file);
+
+      addStatement(function, file);
+    }
+  }
+}
+
+void KLReferenceIndex::removeFile(const KLFile * file)
+{
+  m_invalidFiles.erase(file);
+
+  std::map<const KLFile *, std::set<std::string> >::iterator it = m_fileNames.find(file);
+  if(it == m_fileNames.end())
+    return;
+
+  for(std::set<std::string>::const_iterator name = it->second.begin(); name != it->second.end(); name++)
+  {
+    std::map<std::string, std::vector<KLReference> >::iterator refs = m_references.find(*name);
+    if(refs == m_references.end())
+      continue;
+
+    std::vector<KLReference> & references = refs->second;
+    size_t count = 0;
+    for(size_t i=0;i<references.size();i++)
+    {
+      if(references[i].file != file)
+        references[count++] = references[i];
+    }
+    references.resize(count);
+    if(count == 0)
+      m_references.erase(refs);
+  }
+
+  m_fileNames.erase(it);
+}
+
+void KLReferenceIndex::invalidateFile(const KLFile * file)
+{
+  removeFile(file);
+  m_invalidFiles.insert(file);
+}
+
+void KLReferenceIndex::update() const
+{
+  if(m_invalidFiles.size() == 0)
+    return;
+
+  KLReferenceIndex * mutableThis = (KLReferenceIndex *)this;
+  std::set<const KLFile *> files;
+  files.swap(m_invalidFiles);
+  for(std::set<const KLFile *>::const_iterator it = files.begin(); it != files.end(); it++)
+    mutableThis->addFile(*it);
+}
+
+void KLReferenceIndex::addReference(const std::string & name, KLReferenceKind kind, const KLDecl * decl, const KLFile * file)
+{
+  std::string typeName = KLReferenceIndexTypeName(name);
+  if(typeName.length() == 0)
+    return;
+
+  KLReference reference;
+  reference.kind = kind;
+  reference.decl = decl;
+  reference.file = file;
+  m_references[typeName].push_back(reference);
+  m_fileNames[file].insert(typeName);
+}
+
+void KLReferenceIndex::addStatement(const KLStmt * statement, const KLFile * file)
+{
+  if(statement->isOfDeclType(KLDeclType_VarDeclStmt))
+  {
+    const KLVarDeclStmt * varDecl = (const KLVarDeclStmt *)statement;
+    addReference(varDecl->getBaseType(), KLReferenceKind_VarDeclType, varDecl, file);
+  }
+
+  // conditions, loop headers, initializers and expressions alike
+  for(uint32_t i=0;i<statement->getCallCount();i++)
+    addReference(statement->getCallName(i), KLReferenceKind_Call, statement, file);
+
+  for(uint32_t i=0;i<statement->getChildCount();i++)
+    addStatement(statement->getChild(i), file);
+}
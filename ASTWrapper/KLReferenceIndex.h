@@ -0,0 +1,85 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLReferenceIndex__
+#define __ASTWrapper_KLReferenceIndex__
+
+#include "KLDecl.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+    // forward declarations
+    class KLFile;
+    class KLType;
+    class KLFunction;
+    class KLStmt;
+
+    enum KLReferenceKind
+    {
+      KLReferenceKind_ReturnType,
+      KLReferenceKind_ParameterType,
+      KLReferenceKind_ThisType,
+      KLReferenceKind_MemberType,
+      KLReferenceKind_VarDeclType,
+      KLReferenceKind_Call
+    };
+
+    struct KLReference
+    {
+      KLReferenceKind kind;
+      // the decl the reference was found in, use its location
+      const KLDecl * decl;
+      const KLFile * file;
+    };
+
+    // A reverse index from type and function names to all places within
+    // the loaded KL code referencing them. Names are stored unresolved
+    // (types without array modifiers), since the decls a name resolves
+    // to change as extensions get loaded. The index is kept per file so
+    // a reparse only replaces the references of that file.
+    class KLReferenceIndex
+    {
+      friend class KLASTManager;
+      friend class KLFile;
+
+    public:
+
+      std::vector<KLReference> getReferences(const char * name) const;
+      std::vector<KLReference> getReferences(const KLType * type) const;
+      std::vector<KLReference> getReferences(const KLFunction * function) const;
+      uint32_t getReferenceCount(const char * name) const;
+
+    protected:
+
+      KLReferenceIndex();
+
+      void addFile(const KLFile * file);
+      void removeFile(const KLFile * file);
+      // drops the references of the file and re-adds them on the next query
+      void invalidateFile(const KLFile * file);
+
+    private:
+
+      void update() const;
+
+      void addReference(const std::string & name, KLReferenceKind kind, const KLDecl * decl, const KLFile * file);
+      void addStatement(const KLStmt * statement, const KLFile * file);
+
+      std::map<std::string, std::vector<KLReference> > m_references;
+      // the names each file has contributed to, used for removal
+      std::map<const KLFile *, std::set<std::string> > m_fileNames;
+      mutable std::set<const KLFile *> m_invalidFiles;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLReferenceIndex__
@@ -0,0 +1,112 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLRegisteredTypeTable.h"
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::Threading;
+
+KLRegisteredTypeTable::KLRegisteredTypeTable(const FabricCore::Client * client)
+{
+  if(client)
+    m_client = *client;
+  m_refs = 1;
+  m_stale = true;
+}
+
+KLRegisteredTypeTable::~KLRegisteredTypeTable()
+{
+  join();
+}
+
+void KLRegisteredTypeTable::retain()
+{
+  MutexLocker locker(m_mutex);
+  m_refs++;
+}
+
+void KLRegisteredTypeTable::release()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_refs--;
+    if(m_refs > 0)
+      return;
+  }
+  delete(this);
+}
+
+void KLRegisteredTypeTable::invalidate()
+{
+  MutexLocker locker(m_mutex);
+  m_stale = true;
+}
+
+void KLRegisteredTypeTable::updateInBackground()
+{
+  // the previous background update has to be joined first
+  join();
+  {
+    MutexLocker locker(m_mutex);
+    if(!m_stale)
+      return;
+  }
+  start();
+}
+
+uint32_t KLRegisteredTypeTable::getTypeNames(uint32_t first, std::vector<std::string> & names)
+{
+  join();
+  update();
+
+  MutexLocker locker(m_mutex);
+  for(size_t i=first;i<m_names.size();i++)
+    names.push_back(m_names[i]);
+  return (uint32_t)m_names.size();
+}
+
+void KLRegisteredTypeTable::run()
+{
+  update();
+}
+
+void KLRegisteredTypeTable::update()
+{
+  {
+    MutexLocker locker(m_mutex);
+    if(!m_stale)
+      return;
+    m_stale = false;
+  }
+
+  std::vector<std::string> newNames;
+  try
+  {
+    FabricCore::Variant registeredTypes = FabricCore::GetRegisteredTypes_Variant(m_client);
+    for(FabricCore::Variant::DictIter keyIter(registeredTypes); !keyIter.isDone(); keyIter.next())
+    {
+      std::string key = keyIter.getKey()->getStringData();
+      if(key.length() == 0 || key.substr(key.length()-1, 1) == ">")
+        continue;
+      {
+        // only types not seen before go through the core
+        MutexLocker locker(m_mutex);
+        if(!m_knownNames.insert(key).second)
+          continue;
+      }
+      if(GetRegisteredTypeIsStruct(m_client, key.c_str()))
+        continue;
+      if(GetRegisteredTypeIsObject(m_client, key.c_str()))
+        continue;
+      if(GetRegisteredTypeIsInterface(m_client, key.c_str()))
+        continue;
+      newNames.push_back(key);
+    }
+  }
+  catch(FabricCore::Exception e)
+  {
+    printf("[KLRegisteredTypeTable] Exception while querying registered types: %s\n", e.getDesc_cstr());
+  }
+
+  MutexLocker locker(m_mutex);
+  m_names.insert(m_names.end(), newNames.begin(), newNames.end());
+}
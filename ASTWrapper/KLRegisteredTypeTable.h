@@ -0,0 +1,66 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLRegisteredTypeTable__
+#define __ASTWrapper_KLRegisteredTypeTable__
+
+#include <Threading/Thread.h>
+
+#include <FabricCore.h>
+#include <string>
+#include <vector>
+#include <set>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+
+    // The names of the basic types registered with the core, meaning all
+    // registered types apart from structs, objects, interfaces and
+    // templated types. Asking the core for these costs a call per type,
+    // so the table is shared by everything using a KLASTManager and only
+    // queries types it hasn't seen before. The table is reference
+    // counted, users keep it alive across a change of the manager.
+    class KLRegisteredTypeTable : public Threading::Thread
+    {
+    public:
+
+      KLRegisteredTypeTable(const FabricCore::Client * client);
+
+      void retain();
+      void release();
+
+      // new types might have been registered, the
+      // next lookup asks the core for the new ones
+      void invalidate();
+      // runs the update on a background thread
+      void updateInBackground();
+
+      // appends the names from index first onwards, returns the total
+      // count. this waits for a running background update.
+      uint32_t getTypeNames(uint32_t first, std::vector<std::string> & names);
+
+    protected:
+
+      virtual void run();
+
+    private:
+
+      virtual ~KLRegisteredTypeTable();
+
+      void update();
+
+      FabricCore::Client m_client;
+      uint32_t m_refs;
+      Threading::Mutex m_mutex;
+      bool m_stale;
+      std::vector<std::string> m_names;
+      std::set<std::string> m_knownNames;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLRegisteredTypeTable__
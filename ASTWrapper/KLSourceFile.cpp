@@ -0,0 +1,31 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLSourceFile.h"
+
+#include <stdio.h>
+
+using namespace FabricServices::ASTWrapper;
+
+bool KLSourceFile::read(const char * filePath, std::string & content)
+{
+  content.clear();
+
+  FILE * file = fopen(filePath, "rb");
+  if(!file)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  long fileSize = ftell(file);
+  rewind(file);
+  if(fileSize < 0)
+  {
+    fclose(file);
+    return false;
+  }
+
+  content.resize((size_t)fileSize);
+  if(fileSize > 0)
+    content.resize(fread(&content[0], 1, (size_t)fileSize, file));
+  fclose(file);
+  return true;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLSourceFile__
+#define __ASTWrapper_KLSourceFile__
+
+#include <string>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+
+    // Reads source files from disk. The whole file is read in one go,
+    // straight into the string the caller keeps the content in.
+    class KLSourceFile
+    {
+    public:
+
+      // returns false if the file can't be opened
+      static bool read(const char * filePath, std::string & content);
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLSourceFile__
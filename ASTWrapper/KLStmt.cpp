@@ -11,6 +11,7 @@
 #include "KLLocation.h"
 
 #include <limits.h>
+#include <string.h>
 #include <vector>
 #include <string>
 
@@ -91,30 +92,18 @@ std::vector<const KLStmt*> KLStmt::getAllChildrenOfType(KLDeclType type, bool do
 
 const KLStmt * KLStmt::getStatementAtCursor(uint32_t line, uint32_t column) const
 {
-  uint32_t minDistance = UINT_MAX;
-  const KLStmt * result = NULL;
-
-  if(getCursorDistance(line, column) < minDistance)
-  {
-    result = this;
-    minDistance = getCursorDistance(line, column);
-  }
+  if(!containsCursor(line, column))
+    return NULL;
 
+  // statements are nested, so the innermost match wins
   for(size_t i=0;i<m_statements.size();i++)
   {
     const KLStmt * statement = m_statements[i]->getStatementAtCursor(line, column);
     if(statement)
-    {
-      uint32_t distance = statement->getCursorDistance(line, column);
-      if(distance < minDistance)
-      {
-        result = statement;
-        minDistance = distance;
-      }
-    }
+      return statement;
   }
 
-  return result;
+  return this;
 }
 
 const KLStmt * KLStmt::getParent() const
@@ -143,43 +132,125 @@ const KLStmt * KLStmt::constructChild(JSONData data)
 
   if(type == "CompoundStatement")
   {
-    result = new KLCompoundStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLCompoundStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "ASTCondStmt")
   {
-    result = new KLConditionalStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLConditionalStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "CStyleLoop")
   {
-    result = new KLCStyleLoopStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLCStyleLoopStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "SwitchStatement")
   {
-    result = new KLSwitchStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLSwitchStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "Case")
   {
-    result = new KLCaseStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLCaseStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "VarDeclStatement")
   {
-    result = new KLVarDeclStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLVarDeclStmt(getKLFile(), getNameSpace(), data, this);
   }
   else if(type == "ExprStatement")
   {
-    result = new KLExprStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLExprStmt(getKLFile(), getNameSpace(), data, this);
   }
   else
   {
     // printf("unresolved type '%s'\n", type.c_str());
     // printf("json '%s'\n", data->getJSONEncoding().getStringData());
-    result = new KLStmt(getKLFile(), getNameSpace(), data, this);
+    result = new(getArena()) KLStmt(getKLFile(), getNameSpace(), data, this);
   }
 
+  // the children have collected their own calls by now
+  std::set<JSONData> children(result->m_childData.begin(), result->m_childData.end());
+  std::vector<JSONData>().swap(result->m_childData);
+  result->collectCalls(data, children);
+
+  m_childData.push_back(data);
   m_statements.push_back(result);
   return result;
 }
 
+uint32_t KLStmt::getCallCount() const
+{
+  return m_callNames.size();
+}
+
+const std::string & KLStmt::getCallName(uint32_t index) const
+{
+  return m_callNames[index];
+}
+
+const char * KLStmt::getCallNameKey(const char * type)
+{
+  // the expression nodes of the KL compiler's JSON AST which call
+  // something, with the key holding the name of what is called.
+  // constructors are encoded as calls of the type's name.
+  static const char * callNodes[][2] =
+  {
+    { "Call", "name" },
+    { "MethodOp", "methodName" },
+  };
+
+  for(size_t i=0;i<sizeof(callNodes)/sizeof(callNodes[0]);i++)
+  {
+    if(strcmp(type, callNodes[i][0]) == 0)
+      return callNodes[i][1];
+  }
+  return NULL;
+}
+
+void KLStmt::collectCalls(JSONData data, const std::set<JSONData> & children)
+{
+  if(children.find(data) != children.end())
+    return;
+
+  if(data->isArray())
+  {
+    for(uint32_t i=0;i<data->getArraySize();i++)
+      collectCalls(data->getArrayElement(i), children);
+    return;
+  }
+
+  if(!data->isDict())
+    return;
+
+  JSONData type = data->getDictValue("type");
+  if(type && type->isString())
+  {
+    const char * nameKey = getCallNameKey(type->getStringData());
+    JSONData name = nameKey ? data->getDictValue(nameKey) : NULL;
+    if(name && name->isString())
+      m_callNames.push_back(name->getStringData());
+  }
+
+  for(FabricCore::Variant::DictIter it(*data); !it.isDone(); it.next())
+  {
+    const char * key = it.getKey()->getStringData();
+    if(strcmp(key, "sourceInfo") == 0 || strcmp(key, "preComments") == 0)
+      continue;
+    collectCalls(it.getValue(), children);
+  }
+}
+
+bool KLStmt::containsCursor(uint32_t line, uint32_t column) const
+{
+  const KLLocation * location = getLocation();
+  if(!location)
+    return false;
+  if(location->getLine() > line || location->getEndLine() < line)
+    return false;
+  if(location->getLine() == line && location->getColumn() > column)
+    return false;
+  if(location->getEndLine() == line && location->getEndColumn() < column)
+    return false;
+  return true;
+}
+
 uint32_t KLStmt::getCursorDistance(uint32_t line, uint32_t column) const
 {
   if(getLocation()->getLine() > line || getLocation()->getEndLine() < line)
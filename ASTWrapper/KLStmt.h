@@ -7,6 +7,8 @@
 #include "KLStmtSearch.h"
 
 #include <string>
+#include <vector>
+#include <set>
 
 namespace FabricServices
 {
@@ -33,8 +35,15 @@ namespace FabricServices
 
       virtual std::vector<const KLStmt*> getAllChildrenOfType(KLDeclType type, bool downwards = false, bool upwards = false) const;
 
+      // names of the functions, methods and constructors called within
+      // the expressions of this statement, in order of appearance. calls
+      // within child statements are listed by the children.
+      uint32_t getCallCount() const;
+      const std::string & getCallName(uint32_t index) const;
+
       virtual const KLStmt * getStatementAtCursor(uint32_t line, uint32_t column) const;
       virtual uint32_t getCursorDistance(uint32_t line, uint32_t column) const;
+      virtual bool containsCursor(uint32_t line, uint32_t column) const;
 
     protected:
 
@@ -45,6 +54,17 @@ namespace FabricServices
       KLStmt * m_parent;
       uint32_t m_depth;
       std::vector<KLStmt*> m_statements;
+
+    private:
+
+      // returns the key of the called name for call nodes, NULL otherwise
+      static const char * getCallNameKey(const char * type);
+      void collectCalls(JSONData data, const std::set<JSONData> & children);
+
+      std::vector<std::string> m_callNames;
+      // the JSON of the children, only kept while
+      // the statement itself is being constructed
+      std::vector<JSONData> m_childData;
     };
 
   };
@@ -12,13 +12,15 @@ KLStruct::KLStruct(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData
   if(parentStructName)
     m_parentStructName = parentStructName;
 
+  m_memberTableBuilt = false;
+
   JSONData members = getArrayDictValue("members");
   m_isForwardDecl = members == NULL;
   if(!m_isForwardDecl)
   {
     for(uint32_t i=0;i<members->getArraySize();i++)
     {
-      KLMember * member = new KLMember(klFile, nameSpace, members->getArrayElement(i));
+      KLMember * member = new(getArena()) KLMember(klFile, nameSpace, members->getArrayElement(i));
       m_members.push_back(member);
     }
   }
@@ -50,6 +52,9 @@ const char * KLStruct::getKLType() const
 
 std::vector<const KLType*> KLStruct::getParents() const
 {
+  if(validateCaches() && m_parentsCached)
+    return m_parentsCache;
+
   std::vector<const KLType*> parents; 
   if(m_parentStructName.length() > 0)
   {
@@ -59,25 +64,54 @@ std::vector<const KLType*> KLStruct::getParents() const
       parents.push_back(parent);
     }
   }
+
+  m_parentsCache = parents;
+  m_parentsCached = true;
   return parents;
 }
 
-uint32_t KLStruct::getMemberCount(bool includeInherited) const
+void KLStruct::clearCaches() const
 {
-  if(!includeInherited)
-    return m_members.size();
+  KLType::clearCaches();
+  m_memberTableBuilt = false;
+  m_allMembers.clear();
+  m_allMembersByName.clear();
+}
+
+void KLStruct::buildMemberTable() const
+{
+  if(validateCaches() && m_memberTableBuilt)
+    return;
+
+  m_allMembers.clear();
+  m_allMembersByName.clear();
 
   std::vector<const KLType*> parents = getParents();
-  uint32_t result = 0;
   for(uint32_t i=0;i<parents.size();i++)
   {
     if(parents[i]->getKLType() == std::string("struct") || parents[i]->getKLType() == std::string("object"))
     {
       const KLStruct* parentStruct = (const KLStruct*)parents[i];
-      result += parentStruct->getMemberCount(true);
+      parentStruct->buildMemberTable();
+      m_allMembers.insert(m_allMembers.end(), parentStruct->m_allMembers.begin(), parentStruct->m_allMembers.end());
     }    
   }
-  return result + m_members.size();
+  m_allMembers.insert(m_allMembers.end(), m_members.begin(), m_members.end());
+
+  // the first member of a given name wins, same as a linear scan
+  for(size_t i=0;i<m_allMembers.size();i++)
+    m_allMembersByName.insert(std::pair<std::string, const KLMember*>(m_allMembers[i]->getName(), m_allMembers[i]));
+
+  m_memberTableBuilt = true;
+}
+
+uint32_t KLStruct::getMemberCount(bool includeInherited) const
+{
+  if(!includeInherited)
+    return m_members.size();
+
+  buildMemberTable();
+  return m_allMembers.size();
 }
 
 const KLMember * KLStruct::getMember(uint32_t index, bool includeInherited) const
@@ -85,30 +119,25 @@ const KLMember * KLStruct::getMember(uint32_t index, bool includeInherited) cons
   if(!includeInherited)
     return m_members[index];
 
-  std::vector<const KLType*> parents = getParents();
-  uint32_t offset = index;
-  for(uint32_t i=0;i<parents.size();i++)
-  {
-    if(parents[i]->getKLType() == std::string("struct") || parents[i]->getKLType() == std::string("object")) 
-    {
-      const KLStruct* parentStruct = (const KLStruct*)parents[i];
-      uint32_t memberCount = parentStruct->getMemberCount(true);
-      if(offset < memberCount)
-        return parentStruct->getMember(offset);
-      offset -= memberCount;
-    }    
-  }
-  return m_members[offset];
+  buildMemberTable();
+  return m_allMembers[index];
 }
 
 const KLMember * KLStruct::getMember(const char * name, bool includeInherited) const
 {
-  uint32_t count = getMemberCount(includeInherited);
-  for(uint32_t i=0;i<count;i++)
+  if(!includeInherited)
   {
-    const KLMember * member = getMember(i, includeInherited);
-    if(member->getName() == name)
-      return member;
+    for(uint32_t i=0;i<m_members.size();i++)
+    {
+      if(m_members[i]->getName() == name)
+        return m_members[i];
+    }
+    return NULL;
   }
-  return NULL;
+
+  buildMemberTable();
+  std::map<std::string, const KLMember*>::const_iterator it = m_allMembersByName.find(name);
+  if(it == m_allMembersByName.end())
+    return NULL;
+  return it->second;
 }
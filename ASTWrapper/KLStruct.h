@@ -38,10 +38,20 @@ namespace FabricServices
 
       KLStruct(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData data);
 
+      virtual void clearCaches() const;
+
     private:
+
+      void buildMemberTable() const;
+
       bool m_isForwardDecl;
       std::string m_parentStructName;
       std::vector<const KLMember*> m_members;
+
+      // flattened members including inherited ones (parents first)
+      mutable bool m_memberTableBuilt;
+      mutable std::vector<const KLMember*> m_allMembers;
+      mutable std::map<std::string, const KLMember*> m_allMembersByName;
     };
 
   };
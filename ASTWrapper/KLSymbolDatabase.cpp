@@ -0,0 +1,193 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLSymbolDatabase.h"
+#include "KLExtension.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+# include <windows.h>
+#endif
+
+using namespace FabricServices::ASTWrapper;
+
+#define KLSYMBOLDATABASE_MAGIC "KLSYMDB\0"
+#define KLSYMBOLDATABASE_VERSION 1
+
+static std::string KLSymbolDatabaseEscapeJSON(const char * text)
+{
+  std::string result;
+  for(const char * c = text; *c; c++)
+  {
+    if(*c == '"' || *c == '\\')
+      result += '\\';
+    result += *c;
+  }
+  return result;
+}
+
+static void KLSymbolDatabaseWriteUInt32(std::string & buffer, uint32_t value)
+{
+  buffer.append((const char *)&value, sizeof(uint32_t));
+}
+
+static void KLSymbolDatabaseWriteString(std::string & buffer, const char * value)
+{
+  uint32_t length = (uint32_t)strlen(value);
+  KLSymbolDatabaseWriteUInt32(buffer, length);
+  buffer.append(value, length + 1);
+}
+
+KLSymbolDatabase::KLSymbolDatabase()
+{
+  m_offset = 0;
+}
+
+KLSymbolDatabase::~KLSymbolDatabase()
+{
+}
+
+bool KLSymbolDatabase::open(const char * filePath)
+{
+  m_extensions.clear();
+  m_offset = 0;
+
+  if(!KLSourceFile::read(filePath, m_data))
+    return false;
+  if(m_data.length() < 8 || memcmp(m_data.c_str(), KLSYMBOLDATABASE_MAGIC, 8) != 0)
+    return false;
+  m_offset = 8;
+
+  uint32_t version, extensionCount;
+  if(!readUInt32(version) || version != KLSYMBOLDATABASE_VERSION)
+    return false;
+  if(!readUInt32(extensionCount))
+    return false;
+
+  m_extensions.resize(extensionCount);
+  for(uint32_t i=0;i<extensionCount;i++)
+  {
+    ExtensionRecord & extension = m_extensions[i];
+    uint32_t fileCount;
+    if(!readString(extension.name) || !readString(extension.filePath) ||
+      !readString(extension.manifest) || !readUInt32(fileCount))
+    {
+      m_extensions.clear();
+      return false;
+    }
+
+    extension.files.resize(fileCount);
+    for(uint32_t j=0;j<fileCount;j++)
+    {
+      FileRecord & file = extension.files[j];
+      if(!readString(file.filePath) || !readString(file.code) || !readString(file.jsonAST))
+      {
+        m_extensions.clear();
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+const std::vector<KLSymbolDatabase::ExtensionRecord> & KLSymbolDatabase::getExtensions() const
+{
+  return m_extensions;
+}
+
+bool KLSymbolDatabase::write(const char * filePath, const std::vector<const KLExtension*> & extensions)
+{
+  std::string buffer(KLSYMBOLDATABASE_MAGIC, 8);
+  KLSymbolDatabaseWriteUInt32(buffer, KLSYMBOLDATABASE_VERSION);
+  KLSymbolDatabaseWriteUInt32(buffer, (uint32_t)extensions.size());
+
+  for(size_t i=0;i<extensions.size();i++)
+  {
+    const KLExtension * extension = extensions[i];
+    std::vector<const KLFile*> files = extension->getFiles();
+
+    // the manifest only needs what KLExtension::init reads from it
+    char version[64];
+    sprintf(version, "%u.%u.%u", extension->getVersion().major, extension->getVersion().minor, extension->getVersion().revision);
+    std::string manifest = "{\n\"version\": \"";
+    manifest += version;
+    manifest += "\",\n\"code\": [";
+    for(size_t j=0;j<files.size();j++)
+    {
+      if(j > 0)
+        manifest += ", ";
+      manifest += "\"" + KLSymbolDatabaseEscapeJSON(files[j]->getFilePath()) + "\"";
+    }
+    manifest += "]\n}\n";
+
+    KLSymbolDatabaseWriteString(buffer, extension->getName());
+    KLSymbolDatabaseWriteString(buffer, extension->getFilePath());
+    KLSymbolDatabaseWriteString(buffer, manifest.c_str());
+    KLSymbolDatabaseWriteUInt32(buffer, (uint32_t)files.size());
+
+    for(size_t j=0;j<files.size();j++)
+    {
+      // files which fail to compile are stored without an AST
+      // and go through the compiler again when loaded.
+      std::string jsonAST;
+      try
+      {
+        jsonAST = files[j]->generateJSONAST();
+      }
+      catch(FabricCore::Exception e)
+      {
+        printf("[KLSymbolDatabase] Not storing AST for '%s': '%s'.\n", files[j]->getFilePath(), e.getDesc_cstr());
+      }
+
+      KLSymbolDatabaseWriteString(buffer, files[j]->getFilePath());
+      KLSymbolDatabaseWriteString(buffer, files[j]->getKLCode());
+      KLSymbolDatabaseWriteString(buffer, jsonAST.c_str());
+    }
+  }
+
+  // written next to the target and moved over it once complete, so
+  // a database being read is never truncated or left half written.
+  std::string tempFilePath = filePath;
+  tempFilePath += ".tmp";
+  FILE * file = fopen(tempFilePath.c_str(), "wb");
+  if(!file)
+    return false;
+  bool result = fwrite(buffer.c_str(), 1, buffer.length(), file) == buffer.length();
+  if(fclose(file) != 0)
+    result = false;
+
+  if(result)
+  {
+#if defined(_WIN32)
+    result = MoveFileExA(tempFilePath.c_str(), filePath, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    result = rename(tempFilePath.c_str(), filePath) == 0;
+#endif
+  }
+  if(!result)
+    remove(tempFilePath.c_str());
+  return result;
+}
+
+bool KLSymbolDatabase::readUInt32(uint32_t & value)
+{
+  if(m_offset + sizeof(uint32_t) > m_data.length())
+    return false;
+  memcpy(&value, m_data.c_str() + m_offset, sizeof(uint32_t));
+  m_offset += sizeof(uint32_t);
+  return true;
+}
+
+bool KLSymbolDatabase::readString(const char *& value)
+{
+  uint32_t length;
+  if(!readUInt32(length))
+    return false;
+  if(m_offset + length + 1 > m_data.length() || m_data.c_str()[m_offset + length] != '\0')
+    return false;
+  value = m_data.c_str() + m_offset;
+  m_offset += length + 1;
+  return true;
+}
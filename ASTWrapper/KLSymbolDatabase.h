@@ -0,0 +1,79 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __ASTWrapper_KLSymbolDatabase__
+#define __ASTWrapper_KLSymbolDatabase__
+
+#include "KLSourceFile.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace FabricServices
+{
+
+  namespace ASTWrapper
+  {
+    // forward declarations
+    class KLExtension;
+
+    // A compact binary snapshot of a set of loaded extensions. Next to
+    // the manifest and the code of each file it stores the AST produced
+    // by the KL compiler, which is the expensive part of loading an
+    // extension. The database is read in one go when opened and the
+    // records point into it, the KLFiles copy the stored AST and parse
+    // it instead of invoking the compiler.
+    //
+    // Layout (native byte order):
+    //   char[8] magic, uint32 formatVersion, uint32 extensionCount
+    //   per extension: string name, string filePath, string manifest, uint32 fileCount
+    //   per file: string filePath, string code, string jsonAST
+    // where each string is a uint32 length followed by the bytes and a null terminator.
+    class KLSymbolDatabase
+    {
+    public:
+
+      struct FileRecord
+      {
+        const char * filePath;
+        const char * code;
+        const char * jsonAST;
+      };
+
+      struct ExtensionRecord
+      {
+        const char * name;
+        const char * filePath;
+        const char * manifest;
+        std::vector<FileRecord> files;
+      };
+
+      KLSymbolDatabase();
+      ~KLSymbolDatabase();
+
+      // reads and validates the database, returns false if the file
+      // is missing, truncated or written by an incompatible version.
+      bool open(const char * filePath);
+      const std::vector<ExtensionRecord> & getExtensions() const;
+
+      static bool write(const char * filePath, const std::vector<const KLExtension*> & extensions);
+
+    private:
+
+      // non copyable
+      KLSymbolDatabase(const KLSymbolDatabase & other);
+      KLSymbolDatabase & operator = (const KLSymbolDatabase & other);
+
+      bool readUInt32(uint32_t & value);
+      bool readString(const char *& value);
+
+      std::string m_data;
+      size_t m_offset;
+      std::vector<ExtensionRecord> m_extensions;
+    };
+
+  };
+
+};
+
+#endif // __ASTWrapper_KLSymbolDatabase__
@@ -1,6 +1,8 @@
 // Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
 
 #include "KLType.h"
+#include "KLNameSpace.h"
+#include "KLASTManager.h"
 
 #include <map>
 
@@ -12,14 +14,27 @@ KLType::KLType(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData dat
   const char * name = getStringDictValue("name");
   if(name)
     m_name = name;
+
+  m_parentsCached = false;
+  m_cacheRevision = 0;
 }
 
 KLType::~KLType()
 {
+  // methods and type ops declared in another file live in that
+  // file's arena, so we let the declaring namespace know.
   for(uint32_t i=0;i<m_methods.size();i++)
   {
+    if(m_methods[i]->getKLFile() != getKLFile())
+      ((KLNameSpace*)m_methods[i]->getNameSpace())->detachForeignDecl(m_methods[i]);
     delete(m_methods[i]);
   }
+  for(uint32_t i=0;i<m_typeOps.size();i++)
+  {
+    if(m_typeOps[i]->getKLFile() != getKLFile())
+      ((KLNameSpace*)m_typeOps[i]->getNameSpace())->detachForeignDecl(m_typeOps[i]);
+    delete(m_typeOps[i]);
+  }
 }
 
 KLDeclType KLType::getDeclType() const
@@ -80,6 +95,25 @@ std::vector<const KLMethod*> KLType::getMethods(
   bool sorted
   ) const
 {
+  // the result only depends on the arguments and the AST,
+  // so we memoize it per argument set until the AST changes.
+  std::string cacheKey;
+  cacheKey += includeInherited ? '1' : '0';
+  cacheKey += includeInternal ? '1' : '0';
+  cacheKey += sorted ? '1' : '0';
+  if(category)
+  {
+    cacheKey += ':';
+    cacheKey += category;
+  }
+
+  if(validateCaches())
+  {
+    std::map<std::string, std::vector<const KLMethod*> >::const_iterator it = m_methodsCache.find(cacheKey);
+    if(it != m_methodsCache.end())
+      return it->second;
+  }
+
   std::map<std::string, const KLMethod*> lookup;
   std::vector<const KLMethod*> flatList;
   for(uint32_t i=0;i<m_methods.size();i++)
@@ -118,11 +152,15 @@ std::vector<const KLMethod*> KLType::getMethods(
   }
 
   if(!sorted)
+  {
+    m_methodsCache.insert(std::pair<std::string, std::vector<const KLMethod*> >(cacheKey, flatList));
     return flatList;
+  }
 
   std::vector<const KLMethod*> methods;
   for(std::map<std::string, const KLMethod*>::const_iterator it = lookup.begin(); it != lookup.end(); it++)
     methods.push_back(it->second);
+  m_methodsCache.insert(std::pair<std::string, std::vector<const KLMethod*> >(cacheKey, methods));
   return methods;
 }
 
@@ -160,8 +198,28 @@ std::vector<const KLTypeOp*> KLType::getTypeOps() const
   return m_typeOps;
 }
 
+bool KLType::validateCaches() const
+{
+  uint32_t revision = getASTManager()->getASTRevision();
+  if(m_cacheRevision == revision)
+    return true;
+  clearCaches();
+  m_cacheRevision = revision;
+  return false;
+}
+
+void KLType::clearCaches() const
+{
+  m_parentsCached = false;
+  m_parentsCache.clear();
+  m_methodsCache.clear();
+}
+
 bool KLType::pushMethod(KLMethod * method) const
 {
+  // types deriving from this one may have cached our methods
+  ((KLASTManager*)getASTManager())->bumpASTRevision();
+
   if(m_methodLabelToId.find(method->getLabel()) != m_methodLabelToId.end())
     return false;
   m_methodLabelToId.insert(std::pair<std::string, uint32_t>(method->getLabel(), (uint32_t)m_methods.size()));
@@ -169,6 +227,38 @@ bool KLType::pushMethod(KLMethod * method) const
   return true;
 }
 
+bool KLType::removeMethod(const KLMethod * method) const
+{
+  ((KLASTManager*)getASTManager())->bumpASTRevision();
+
+  for(size_t i=0;i<m_methods.size();i++)
+  {
+    if(m_methods[i] != method)
+      continue;
+    m_methods.erase(m_methods.begin() + i);
+    m_methodLabelToId.clear();
+    for(size_t j=0;j<m_methods.size();j++)
+      m_methodLabelToId.insert(std::pair<std::string, uint32_t>(m_methods[j]->getLabel(), (uint32_t)j));
+    return true;
+  }
+  return false;
+}
+
+bool KLType::removeTypeOp(const KLTypeOp * typeOp) const
+{
+  for(size_t i=0;i<m_typeOps.size();i++)
+  {
+    if(m_typeOps[i] != typeOp)
+      continue;
+    m_typeOps.erase(m_typeOps.begin() + i);
+    m_typeOpLabelToId.clear();
+    for(size_t j=0;j<m_typeOps.size();j++)
+      m_typeOpLabelToId.insert(std::pair<std::string, uint32_t>(m_typeOps[j]->getLabel(), (uint32_t)j));
+    return true;
+  }
+  return false;
+}
+
 bool KLType::pushTypeOp(KLTypeOp * typeOp) const
 {
   if(m_typeOpLabelToId.find(typeOp->getLabel()) != m_typeOpLabelToId.end())
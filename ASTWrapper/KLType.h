@@ -49,14 +49,26 @@ namespace FabricServices
       KLType(const KLFile* klFile, const KLNameSpace * nameSpace, JSONData data);
       bool pushMethod(KLMethod * method) const;
       bool pushTypeOp(KLTypeOp * typeOp) const;
+      bool removeMethod(const KLMethod * method) const;
+      bool removeTypeOp(const KLTypeOp * typeOp) const;
+
+      // returns true if the cached lookups are still valid for the
+      // current AST revision, otherwise clears them and returns false.
+      bool validateCaches() const;
+      virtual void clearCaches() const;
+
       mutable std::vector<KLMethod*> m_methods;
       mutable std::map<std::string, uint32_t> m_methodLabelToId;
       mutable std::vector<const KLTypeOp*> m_typeOps;
       mutable std::map<std::string, uint32_t> m_typeOpLabelToId;
+      mutable bool m_parentsCached;
+      mutable std::vector<const KLType*> m_parentsCache;
 
     private:
       
       std::string m_name;
+      mutable uint32_t m_cacheRevision;
+      mutable std::map<std::string, std::vector<const KLMethod*> > m_methodsCache;
     };
 
   };
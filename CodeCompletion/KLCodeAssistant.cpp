@@ -2,7 +2,8 @@
 
 #include "KLCodeAssistant.h"
 #include <FTL/StrFilter.h>
-#include <FTL/StrSplit.h>
+
+#include <algorithm>
 
 using namespace FabricServices::ASTWrapper;
 using namespace FabricServices::CodeCompletion;
@@ -43,11 +44,21 @@ KLCodeAssistant::KLCodeAssistant(KLSyntaxHighlighter * highlighter)
 
 KLCodeAssistant::~KLCodeAssistant()
 {
+  if(m_parseWorker)
+    delete(m_parseWorker);
+  if(m_semanticTokens)
+    delete(m_semanticTokens);
 }
 
 void KLCodeAssistant::init()
 {
   m_file = NULL;
+  m_astDirty = false;
+  m_dirtyStart = 0;
+  m_dirtyEnd = 0;
+  m_codeRevision = 0;
+  m_parseWorker = NULL;
+  m_semanticTokens = NULL;
 }
 
 bool KLCodeAssistant::setASTManager(KLASTManager * manager)
@@ -56,6 +67,13 @@ bool KLCodeAssistant::setASTManager(KLASTManager * manager)
   {
     if(m_owningHighlighter && m_highlighter)
       m_highlighter->setASTManager(manager);
+    if(m_parseWorker)
+    {
+      // the worker compiles against the client of the manager
+      uint32_t debounce = m_parseWorker->getDebounceMilliseconds();
+      delete(m_parseWorker);
+      m_parseWorker = manager ? new KLParseWorker(manager->getClient(), debounce) : NULL;
+    }
     return true;
   }
   return false;
@@ -71,6 +89,11 @@ const KLFile * KLCodeAssistant::getKLFile()
   return m_file;
 }
 
+const std::string & KLCodeAssistant::getCode() const
+{
+  return m_code;
+}
+
 std::vector<const KLError*> KLCodeAssistant::getKLErrors()
 {
   if(m_file)
@@ -92,8 +115,8 @@ bool KLCodeAssistant::updateCurrentKLFile(const KLFile * file)
   m_code = m_file->getKLCode();
 
   m_code = FTL::StrFilter<MatchCharBackSlashR>( m_code );
-  m_lines.clear();
-  FTL::StrSplit<'\n'>(m_code, m_lines, true);
+  updateLineTable();
+  m_astDirty = false;
   return true;
 }
 
@@ -113,52 +136,218 @@ bool KLCodeAssistant::updateCurrentCodeAndFile(const std::string & code, const s
   m_code = newCode;
   m_fileName = fileName;
   
-  m_lines.clear();
-  FTL::StrSplit<'\n'>(m_code, m_lines, true);
+  updateLineTable();
+  m_codeRevision++;
 
+  m_astDirty = true;
+  m_dirtyStart = 0;
+  m_dirtyEnd = m_code.length();
   if(updateAST)
+    this->updateAST(dfgExec);
+
+  return updateAST;
+}
+
+bool KLCodeAssistant::applyEdit(uint32_t offset, uint32_t removedLength, const std::string & insertedText, bool updateAST, FabricCore::DFGExec *dfgExec)
+{
+  if(!hasASTManager())
+    return false;
+  if(m_fileName.length() == 0 || offset > m_code.length())
+    return false;
+
+  if(removedLength > m_code.length() - offset)
+    removedLength = m_code.length() - offset;
+
+  std::string text = insertedText;
+  if(text.find('\r') != std::string::npos)
+    text = FTL::StrFilter<MatchCharBackSlashR>( text );
+  if(removedLength == 0 && text.length() == 0)
+    return false;
+
+  m_code.replace(offset, removedLength, text);
+  updateLineTable(offset, removedLength, text);
+  m_codeRevision++;
+
+  // grow the dirty range to cover this edit, shifting
+  // the part of it behind the edit along with the code
+  uint32_t editEnd = offset + text.length();
+  if(!m_astDirty)
   {
-    try {
-      if(m_file == NULL)
-        m_file = getASTManager()->loadSingleKLFile(m_fileName.c_str(), m_code.c_str(), dfgExec);
-      else if(m_file->getAbsoluteFilePath() != fileName)
-        m_file = getASTManager()->loadSingleKLFile(m_fileName.c_str(), m_code.c_str(), dfgExec);
-      else
-        ((KLFile*)m_file)->updateKLCode(m_code.c_str());
-    }
-    catch( FabricCore::Exception e ) {
-      printf( "Exception while parsing for KL syntax highlighting: %s\n", e.getDesc_cstr() );
-    }
+    m_dirtyStart = offset;
+    m_dirtyEnd = editEnd;
+  }
+  else
+  {
+    if(m_dirtyEnd > offset + removedLength)
+      m_dirtyEnd = m_dirtyEnd - removedLength + text.length();
+    else if(m_dirtyEnd > offset)
+      m_dirtyEnd = offset;
+    if(offset < m_dirtyStart)
+      m_dirtyStart = offset;
+    if(editEnd > m_dirtyEnd)
+      m_dirtyEnd = editEnd;
+  }
+  m_astDirty = true;
+
+  if(updateAST)
+    this->updateAST(dfgExec);
+  return true;
+}
+
+bool KLCodeAssistant::isASTDirty() const
+{
+  return m_astDirty;
+}
+
+void KLCodeAssistant::getDirtyRange(uint32_t & start, uint32_t & end) const
+{
+  start = m_dirtyStart;
+  end = m_dirtyEnd;
+}
+
+bool KLCodeAssistant::updateAST(FabricCore::DFGExec *dfgExec)
+{
+  if(!hasASTManager() || !m_astDirty)
+    return false;
+
+  // files which are already loaded are compiled in the background,
+  // the AST stays dirty until the result has been published.
+  if(m_parseWorker && m_file != NULL && m_file->getAbsoluteFilePath() == m_fileName)
+  {
+    if(!m_parseWorker->hasPendingRequest(m_codeRevision))
+      m_parseWorker->request(m_codeRevision, m_fileName, m_code, dfgExec);
+    return false;
+  }
+
+  m_astDirty = false;
 
-    // update all error formats
-    m_highlighter->clearErrors();
-    if(m_file->hasErrors())
+  try {
+    if(m_file == NULL)
+      m_file = getASTManager()->loadSingleKLFile(m_fileName.c_str(), m_code.c_str(), dfgExec);
+    else if(m_file->getAbsoluteFilePath() != m_fileName)
+      m_file = getASTManager()->loadSingleKLFile(m_fileName.c_str(), m_code.c_str(), dfgExec);
+    else
+      ((KLFile*)m_file)->updateKLCode(m_code.c_str());
+  }
+  catch( FabricCore::Exception e ) {
+    printf( "Exception while parsing for KL syntax highlighting: %s\n", e.getDesc_cstr() );
+  }
+
+  updateErrorFormats();
+  requestSemanticTokens();
+  return true;
+}
+
+void KLCodeAssistant::setAsyncParsing(bool enabled, uint32_t debounceMilliseconds)
+{
+  if(m_parseWorker)
+  {
+    delete(m_parseWorker);
+    m_parseWorker = NULL;
+  }
+  if(enabled && hasASTManager())
+    m_parseWorker = new KLParseWorker(getASTManager()->getClient(), debounceMilliseconds);
+}
+
+bool KLCodeAssistant::isAsyncParsing() const
+{
+  return m_parseWorker != NULL;
+}
+
+bool KLCodeAssistant::processParseResults()
+{
+  if(!m_parseWorker || !hasASTManager())
+    return false;
+
+  uint32_t revision;
+  std::string code, jsonAST;
+  if(!m_parseWorker->takeResult(revision, code, jsonAST))
+    return false;
+
+  // the code has been edited since, a newer request is on its way
+  if(revision != m_codeRevision || !m_astDirty)
+    return false;
+  if(m_file == NULL || m_file->getAbsoluteFilePath() != m_fileName)
+    return false;
+
+  m_astDirty = false;
+
+  try {
+    ((KLFile*)m_file)->updateKLCode(code.c_str(), jsonAST.c_str());
+  }
+  catch( FabricCore::Exception e ) {
+    printf( "Exception while parsing for KL syntax highlighting: %s\n", e.getDesc_cstr() );
+  }
+
+  updateErrorFormats();
+  requestSemanticTokens();
+  return true;
+}
+
+void KLCodeAssistant::setSemanticTokensEnabled(bool enabled)
+{
+  if(enabled == (m_semanticTokens != NULL))
+    return;
+  if(!enabled)
+  {
+    delete(m_semanticTokens);
+    m_semanticTokens = NULL;
+    return;
+  }
+  m_semanticTokens = new KLSemanticTokens();
+  if(!m_astDirty)
+    requestSemanticTokens();
+}
+
+bool KLCodeAssistant::isSemanticTokensEnabled() const
+{
+  return m_semanticTokens != NULL;
+}
+
+bool KLCodeAssistant::takeSemanticTokenDelta(KLSemanticTokens::Delta & delta)
+{
+  if(!m_semanticTokens)
+    return false;
+  return m_semanticTokens->takeDelta(delta);
+}
+
+void KLCodeAssistant::requestSemanticTokens()
+{
+  if(!m_semanticTokens || !m_file || m_file->getAbsoluteFilePath() != m_fileName)
+    return;
+  m_semanticTokens->request(m_codeRevision, m_code, m_file, m_highlighter->getUseCoreTokenStream());
+}
+
+void KLCodeAssistant::updateErrorFormats()
+{
+  m_highlighter->clearErrors();
+  if(m_file && m_file->hasErrors())
+  {
+    std::vector<const KLError*> errors = m_file->getErrors();
+    for(size_t i=0;i<errors.size();i++)
     {
-      std::vector<const KLError*> errors = m_file->getErrors();
-      for(size_t i=0;i<errors.size();i++)
+      if(errors[i]->getLine() <= static_cast<int>( getLineCount() ))
       {
-        if(errors[i]->getLine() <= static_cast<int>( m_lines.size() ))
-        {
-          uint32_t cursor;
-          lineAndColumnToCursor(errors[i]->getLine(), 1, cursor);
-          m_highlighter->reportError(cursor, m_lines[errors[i]->getLine()-1].length());
-        }
+        uint32_t cursor;
+        lineAndColumnToCursor(errors[i]->getLine(), 1, cursor);
+        m_highlighter->reportError(cursor, getLineLength(errors[i]->getLine()));
       }
     }
   }
-
-  return updateAST;
 }
 
 void KLCodeAssistant::lineAndColumnToCursor(uint32_t line, uint32_t column, uint32_t & cursor) const
 {
   cursor = 0;
-  for(uint32_t l=1; l<line; l++)
+  if(line > 1 && line > m_lineStarts.size())
   {
-    if(l >= m_lines.size())
-      return;
-    cursor += m_lines[l-1].length() + 1;
+    // past the end, clamp to the start of the last line
+    if(m_lineStarts.size() > 0)
+      cursor = m_lineStarts[m_lineStarts.size() - 1];
+    return;
   }
+  if(line > 1)
+    cursor = m_lineStarts[line-1];
   cursor += column - 1;
 }
 
@@ -166,21 +355,83 @@ void KLCodeAssistant::cursorToLineAndColumn(uint32_t cursor,  uint32_t & line, u
 {
   line = 0;
   column = 0;
-  if(m_lines.size() == 0)
+  if(m_lineStarts.size() == 0)
     return;
 
-  uint32_t sum = cursor;
-  for(line=1; line<=m_lines.size(); line++)
+  // the last line starting at or before the cursor
+  std::vector<uint32_t>::const_iterator it =
+    std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), cursor);
+  line = (uint32_t)(it - m_lineStarts.begin());
+
+  uint32_t offset = cursor - m_lineStarts[line-1];
+  uint32_t length = getLineLength(line);
+  if(offset <= length)
   {
-    if(sum <= m_lines[line-1].length())
-    {
-      column = sum + 1;
-      return;
-    }
-    sum -= m_lines[line-1].length() + 1;
+    column = offset + 1;
+    return;
+  }
+
+  // past the end of the code
+  line = m_lineStarts.size() + 1;
+  column = length + 1;
+}
+
+void KLCodeAssistant::updateLineTable()
+{
+  m_lineStarts.clear();
+  if(m_code.length() == 0)
+    return;
+
+  m_lineStarts.push_back(0);
+  for(size_t pos = m_code.find('\n'); pos != std::string::npos; pos = m_code.find('\n', pos + 1))
+    m_lineStarts.push_back((uint32_t)pos + 1);
+}
+
+void KLCodeAssistant::updateLineTable(uint32_t offset, uint32_t removedLength, const std::string & insertedText)
+{
+  if(m_lineStarts.size() == 0 || m_code.length() == 0)
+  {
+    updateLineTable();
+    return;
   }
 
-  column = m_lines[m_lines.size() - 1].length() + 1;
+  // drop the lines starting inside the removed text, shift
+  // the ones behind it and add the lines of the inserted text
+  std::vector<uint32_t>::iterator first =
+    std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset);
+  std::vector<uint32_t>::iterator last =
+    std::upper_bound(first, m_lineStarts.end(), offset + removedLength);
+  size_t index = m_lineStarts.erase(first, last) - m_lineStarts.begin();
+
+  int32_t delta = (int32_t)insertedText.length() - (int32_t)removedLength;
+  for(size_t i=index;i<m_lineStarts.size();i++)
+    m_lineStarts[i] += delta;
+
+  std::vector<uint32_t> insertedStarts;
+  for(size_t pos = insertedText.find('\n'); pos != std::string::npos; pos = insertedText.find('\n', pos + 1))
+    insertedStarts.push_back(offset + (uint32_t)pos + 1);
+  m_lineStarts.insert(m_lineStarts.begin() + index, insertedStarts.begin(), insertedStarts.end());
+}
+
+uint32_t KLCodeAssistant::getLineCount() const
+{
+  return m_lineStarts.size();
+}
+
+uint32_t KLCodeAssistant::getLineLength(uint32_t line) const
+{
+  if(line == 0 || line > m_lineStarts.size())
+    return 0;
+  if(line == m_lineStarts.size())
+    return m_code.length() - m_lineStarts[line-1];
+  return m_lineStarts[line] - m_lineStarts[line-1] - 1;
+}
+
+std::string KLCodeAssistant::getLine(uint32_t line) const
+{
+  if(line == 0 || line > m_lineStarts.size())
+    return "";
+  return m_code.substr(m_lineStarts[line-1], getLineLength(line));
 }
 
 bool KLCodeAssistant::isCursorInsideCommentOrString(uint32_t cursor) const
@@ -247,10 +498,10 @@ std::string KLCodeAssistant::getWordAtCursor(uint32_t cursor, bool ignoreParenth
 
 std::string KLCodeAssistant::getWordAtCursor(uint32_t line, uint32_t column, bool ignoreParentheses) const
 {
-  if(line > m_lines.size() || line == 0)
+  if(line > getLineCount() || line == 0)
     return "";
 
-  const std::string & l = m_lines[line-1];
+  std::string l = getLine(line);
   if(column > l.length())
     column = l.length();
   if(column == 0)
@@ -291,10 +542,10 @@ std::string KLCodeAssistant::getCharAtCursor(uint32_t cursor) const
 
 std::string KLCodeAssistant::getCharAtCursor(uint32_t line, uint32_t column) const
 {
-  if(line > m_lines.size() || line == 0)
+  if(line > getLineCount() || line == 0)
     return "";
 
-  const std::string & l = m_lines[line-1];
+  std::string l = getLine(line);
   if(column > l.length())
     column = l.length();
   if(column == 0)
@@ -313,40 +564,44 @@ std::vector<KLVariable> KLCodeAssistant::getVariablesAtCursor(uint32_t cursor) c
 std::vector<KLVariable> KLCodeAssistant::getVariablesAtCursor(uint32_t line, uint32_t column) const
 {
   std::vector<KLVariable> result;
-  if(!hasASTManager())
+  const KLFunction * function = getFunctionAtCursor(line, column);
+  if(!function)
     return result;
-  const KLStmt * statement = getStatementAtCursor(line, column);
-  if(statement)
+
+  // innermost first, so the first match of a name is the one in scope
+  uint32_t count = function->getLocalVariablesDeclaredBefore(line, column);
+  for(uint32_t i=count;i>0;i--)
   {
-    if(statement->isOfDeclType(KLDeclType_Function))
-      statement = ((KLFunction*)statement)->getBody();
+    const KLLocalVariable & variable = function->getLocalVariable(i-1);
+    if(!variable.isVisibleAt(line, column))
+      continue;
+    if(variable.isParameter)
+      result.push_back(KLVariable(variable.name, variable.type));
+    else
+      result.push_back(KLVariable(variable.name, variable.type, variable.arrayModifier));
   }
-  if(statement)
-  {
-    std::vector<const KLStmt *> varDecls = statement->getAllChildrenOfType(KLDeclType_VarDeclStmt, false, true);
-    for(size_t i=0;i<varDecls.size();i++)
-    {
-      const KLVarDeclStmt * varDecl = (const KLVarDeclStmt *)varDecls[i];
-      for(uint32_t j=0;j<varDecl->getCount();j++)
-      {
-        result.push_back(KLVariable(varDecl->getName(j), varDecl->getBaseType(), varDecl->getArrayModifier(j)));
-      }
-    }
 
-    statement = statement->getTop();
+  return result;
+}
 
-    if(statement->isOfDeclType(KLDeclType_Function))
-    {
-      KLFunction * function = (KLFunction *)statement;
-      for(uint32_t i=0;i<function->getParameterCount();i++)
-      {
-        const KLParameter * param = function->getParameter(i);
-        result.push_back(KLVariable(param->getName(), param->getType()));
-      }        
-    }
-  }
+const KLFunction * KLCodeAssistant::getFunctionAtCursor(uint32_t cursor) const
+{
+  uint32_t line, column;
+  cursorToLineAndColumn(cursor, line, column);
+  return getFunctionAtCursor(line, column);
+}
 
-  return result;
+const KLFunction * KLCodeAssistant::getFunctionAtCursor(uint32_t line, uint32_t column) const
+{
+  if(!hasASTManager())
+    return NULL;
+  const KLStmt * statement = getStatementAtCursor(line, column);
+  if(!statement)
+    return NULL;
+  statement = statement->getTop();
+  if(!statement->isOfDeclType(KLDeclType_Function))
+    return NULL;
+  return (const KLFunction *)statement;
 }
 
 const KLDecl * KLCodeAssistant::getDeclAtCursor(uint32_t cursor) const
@@ -360,10 +615,10 @@ const KLDecl * KLCodeAssistant::getDeclAtCursor(uint32_t line, uint32_t column)
 {
   if(!hasASTManager())
     return NULL;
-  if(line > m_lines.size() || line == 0)
+  if(line > getLineCount() || line == 0)
     return NULL;
 
-  const std::string & l = m_lines[line-1];
+  std::string l = getLine(line);
   if(column > l.length())
     column = l.length();
   if(column == 0)
@@ -461,12 +716,17 @@ const KLDecl * KLCodeAssistant::getDeclAtCursor(uint32_t line, uint32_t column)
     // try all variables
     if(type == NULL)
     {
-      std::vector<KLVariable> vars = getVariablesAtCursor(line, i+1);
-      for(size_t i=0;i<vars.size();i++)
+      const KLFunction * function = getFunctionAtCursor(line, i+1);
+      if(function)
       {
-        if(vars[i].getName() == word)
+        // innermost first, as getVariablesAtCursor
+        uint32_t count = function->getLocalVariablesDeclaredBefore(line, i+1);
+        for(uint32_t j=count;j>0;j--)
         {
-          type = getASTManager()->getKLTypeByName(resolveAliases(vars[i].getBaseType().c_str()), m_file);
+          const KLLocalVariable & variable = function->getLocalVariable(j-1);
+          if(variable.name != word || !variable.isVisibleAt(line, i+1))
+            continue;
+          type = getASTManager()->getKLTypeByName(resolveAliases(KLTypeDesc(variable.type).getBaseType().c_str()).c_str(), m_file);
           if(type)
             break;
         }
@@ -476,39 +736,31 @@ const KLDecl * KLCodeAssistant::getDeclAtCursor(uint32_t line, uint32_t column)
     // maybe this is a type itself
     if(type == NULL)
     {
-      type = getASTManager()->getKLTypeByName(resolveAliases(word.c_str()), m_file);
+      type = getASTManager()->getKLTypeByName(resolveAliases(word.c_str()).c_str(), m_file);
     }
 
     // maybe this is a function
     if(type == NULL)
     {
-      std::vector<const KLFunction*> functions = getASTManager()->getFunctions();
+      std::vector<const KLFunction*> functions = getASTManager()->getFunctionsByName(word.c_str());
       for(size_t i=0;i<functions.size();i++)
       {
-        if(functions[i]->getName() == word)
-        {
-          if(delegates.size() == 0)
-            return functions[i];
+        if(delegates.size() == 0)
+          return functions[i];
 
-          KLTypeDesc returnType(functions[i]->getReturnType());
-          type = getASTManager()->getKLTypeByName(resolveAliases(returnType.getBaseType().c_str()), m_file);
-          if(type)
-            break;
-        }
+        KLTypeDesc returnType(functions[i]->getReturnType());
+        type = getASTManager()->getKLTypeByName(resolveAliases(returnType.getBaseType().c_str()).c_str(), m_file);
+        if(type)
+          break;
       }
     }
 
     // maybe this is a constant
     if(type == NULL)
     {
-      std::vector<const KLConstant*> constants = getASTManager()->getConstants();
-      for(size_t i=0;i<constants.size();i++)
-      {
-        if(constants[i]->getName() == word)
-        {
-          return constants[i];
-        }
-      }
+      const KLConstant * constant = getASTManager()->getConstantByName(word.c_str());
+      if(constant)
+        return constant;
     }
   }
 
@@ -530,7 +782,7 @@ const KLDecl * KLCodeAssistant::getDeclAtCursor(uint32_t line, uint32_t column)
           return method;
 
         KLTypeDesc returnType(method->getReturnType());
-        type = getASTManager()->getKLTypeByName(resolveAliases(returnType.getBaseType().c_str()), m_file);
+        type = getASTManager()->getKLTypeByName(resolveAliases(returnType.getBaseType().c_str()).c_str(), m_file);
         if(type == NULL)
           return NULL;
         found = true;
@@ -582,7 +834,7 @@ const KLType * KLCodeAssistant::getTypeAtCursor(uint32_t line, uint32_t column,
         if(decl->isOfDeclType(KLDeclType_Method))
         {
           // walk backwards and check if there is a brace
-          std::string l = m_lines[line-1];
+          std::string l = getLine(line);
           int c = column-1;
           while(c >= 0)
           {
@@ -597,35 +849,17 @@ const KLType * KLCodeAssistant::getTypeAtCursor(uint32_t line, uint32_t column,
           }
         }
       }
-      return getASTManager()->getKLTypeByName(resolveAliases(typeDesc.getBaseType().c_str()), m_file);
+      return getASTManager()->getKLTypeByName(resolveAliases(typeDesc.getBaseType().c_str()).c_str(), m_file);
     }
   }
   return NULL;
 }
 
-const char * KLCodeAssistant::resolveAliases(const char * name) const
+std::string KLCodeAssistant::resolveAliases(const char * name) const
 {
   if(!hasASTManager())
     return name;
-  std::vector<const KLAlias*> aliases = getASTManager()->getAliases();
-  const char * result = name;
-
-  bool found = true;
-  while(found)
-  {
-    found = false;
-    for(size_t i=0;i<aliases.size();i++)
-    {
-      if(aliases[i]->getNewUserName() == result)
-      {
-        result = aliases[i]->getOldUserName().c_str();
-        found = true;
-        break;
-      }
-    }
-  }
-  
-  return result;
+  return getASTManager()->resolveAlias(name);
 }
 
 
@@ -5,6 +5,8 @@
 
 #include "KLSyntaxHighlighter.h"
 #include "KLVariable.h"
+#include "KLParseWorker.h"
+#include "KLSemanticTokens.h"
 #include <ASTWrapper/KLASTManager.h>
 #include <ASTWrapper/KLASTClient.h>
 #include <map>
@@ -27,11 +29,41 @@ namespace FabricServices
 
       KLSyntaxHighlighter * getHighlighter();
       const ASTWrapper::KLFile * getKLFile();
+      const std::string & getCode() const;
       std::vector<const ASTWrapper::KLError*> getKLErrors();
 
       bool updateCurrentKLFile(const ASTWrapper::KLFile * file);
       bool updateCurrentCodeAndFile(const std::string & code, const std::string & fileName, bool updateAST = true, FabricCore::DFGExec *dfgExec = NULL);
 
+      // applies a single edit to the current code, replacing removedLength
+      // characters at offset with the inserted text. only the edited region
+      // of the line table is updated. if updateAST is false the AST is only
+      // flagged dirty and brought up to date by the next call to updateAST.
+      bool applyEdit(uint32_t offset, uint32_t removedLength, const std::string & insertedText, bool updateAST = true, FabricCore::DFGExec *dfgExec = NULL);
+      bool isASTDirty() const;
+      // the range of the current code edited since the AST was last updated
+      void getDirtyRange(uint32_t & start, uint32_t & end) const;
+      bool updateAST(FabricCore::DFGExec *dfgExec = NULL);
+
+      // in asynchronous mode updateAST hands the code to a worker thread
+      // which compiles it once the edits have settled for the debounce
+      // interval. all queries keep using the last good AST until the
+      // result is published by processParseResults, which the owner has
+      // to call regularly (for example from a UI timer). the very first
+      // parse of a file is always synchronous.
+      void setAsyncParsing(bool enabled, uint32_t debounceMilliseconds = 300);
+      bool isAsyncParsing() const;
+      // publishes a finished background parse, returns true if the AST
+      // and the error list were replaced.
+      bool processParseResults();
+
+      // semantic tokens classify the identifiers of the code through the
+      // AST, on a worker thread after every parse. the first delta taken
+      // after enabling holds all tokens, later ones only the changes.
+      void setSemanticTokensEnabled(bool enabled);
+      bool isSemanticTokensEnabled() const;
+      bool takeSemanticTokenDelta(KLSemanticTokens::Delta & delta);
+
       void lineAndColumnToCursor(uint32_t line, uint32_t column, uint32_t & cursor) const;
       void cursorToLineAndColumn(uint32_t cursor,  uint32_t & line, uint32_t & column) const;
 
@@ -49,6 +81,10 @@ namespace FabricServices
 
       std::vector<KLVariable> getVariablesAtCursor(uint32_t cursor) const;
       std::vector<KLVariable> getVariablesAtCursor(uint32_t line, uint32_t column) const;
+      // the function containing the cursor, its scope table lists the
+      // variables visible at the cursor without building KLVariables.
+      const ASTWrapper::KLFunction * getFunctionAtCursor(uint32_t cursor) const;
+      const ASTWrapper::KLFunction * getFunctionAtCursor(uint32_t line, uint32_t column) const;
 
       const ASTWrapper::KLDecl * getDeclAtCursor(uint32_t cursor) const;
       const ASTWrapper::KLDecl * getDeclAtCursor(uint32_t line, uint32_t column) const;
@@ -58,15 +94,32 @@ namespace FabricServices
     private:
 
       void init();
-      const char * resolveAliases(const char * name) const;
+      std::string resolveAliases(const char * name) const;
+
+      // the line table holds the offset of the first character of each
+      // line within m_code, and is rebuilt whenever the code changes.
+      void updateLineTable();
+      void updateLineTable(uint32_t offset, uint32_t removedLength, const std::string & insertedText);
+      uint32_t getLineCount() const;
+      uint32_t getLineLength(uint32_t line) const;
+      std::string getLine(uint32_t line) const;
+      void updateErrorFormats();
+      void requestSemanticTokens();
 
       KLSyntaxHighlighter * m_highlighter;
       bool m_owningHighlighter;
 
       std::string m_code;
-      std::vector<std::string> m_lines;
+      std::vector<uint32_t> m_lineStarts;
       std::string m_fileName;
       const ASTWrapper::KLFile * m_file;
+      bool m_astDirty;
+      uint32_t m_dirtyStart;
+      uint32_t m_dirtyEnd;
+      // bumped on every change of m_code, used to drop stale parse results
+      uint32_t m_codeRevision;
+      KLParseWorker * m_parseWorker;
+      KLSemanticTokens * m_semanticTokens;
     };
 
   };
@@ -0,0 +1,412 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLCompletionEngine.h"
+
+#include <algorithm>
+#include <ctype.h>
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::CodeCompletion;
+
+// score bonuses on top of the name match
+#define KLCOMPLETION_SCORE_EXACT 400
+#define KLCOMPLETION_SCORE_CASE 200
+#define KLCOMPLETION_SCORE_VARIABLE 300
+#define KLCOMPLETION_SCORE_CURRENT_FILE 50
+#define KLCOMPLETION_SCORE_UNDERSCORE -100
+
+static std::string KLCompletionLower(const std::string & text)
+{
+  std::string result = text;
+  for(size_t i=0;i<result.length();i++)
+    result[i] = (char)tolower(result[i]);
+  return result;
+}
+
+static bool KLCompletionHasPrefix(const std::string & name, const std::string & lowerPrefix)
+{
+  if(name.length() < lowerPrefix.length())
+    return false;
+  for(size_t i=0;i<lowerPrefix.length();i++)
+  {
+    if(tolower(name[i]) != lowerPrefix[i])
+      return false;
+  }
+  return true;
+}
+
+static bool KLCompletionCandidateLess(const KLCompletionEngine::Candidate & a, const KLCompletionEngine::Candidate & b)
+{
+  if(a.score != b.score)
+    return a.score > b.score;
+  if(a.name != b.name)
+    return a.name < b.name;
+  return a.kind < b.kind;
+}
+
+bool KLCompletionEngine::Entry::operator < (const Entry & other) const
+{
+  if(key != other.key)
+    return key < other.key;
+  if(name != other.name)
+    return name < other.name;
+  return kind < other.kind;
+}
+
+KLCompletionEngine::KLCompletionEngine(KLCodeAssistant * assistant)
+: ASTWrapper::KLASTClient(assistant->getASTManager())
+{
+  m_assistant = assistant;
+  m_needsRebuild = true;
+  m_indexRevision = 0;
+  m_changeTracked = false;
+}
+
+KLCompletionEngine::~KLCompletionEngine()
+{
+}
+
+const char * KLCompletionEngine::getKindName(Kind kind)
+{
+  switch ( kind )
+  {
+    case Kind_Variable: return "Variable";
+    case Kind_Type: return "Type";
+    case Kind_Function: return "Function";
+    case Kind_Method: return "Method";
+    case Kind_Member: return "Member";
+    case Kind_Constant: return "Constant";
+    case Kind_Alias: return "Alias";
+    default: return "***UNKNOWN***";
+  }
+}
+
+bool KLCompletionEngine::setASTManager(KLASTManager * manager)
+{
+  if(ASTWrapper::KLASTClient::setASTManager(manager))
+  {
+    m_index.clear();
+    m_pendingFiles.clear();
+    m_needsRebuild = true;
+    return true;
+  }
+  return false;
+}
+
+void KLCompletionEngine::onExtensionLoaded(const KLExtension * extension)
+{
+  // loaded files don't have any decls until they are parsed
+  m_changeTracked = true;
+}
+
+void KLCompletionEngine::onExtensionParsed(const KLExtension * extension)
+{
+  std::vector<const KLFile*> files = extension->getFiles();
+  m_pendingFiles.insert(files.begin(), files.end());
+  m_changeTracked = true;
+}
+
+void KLCompletionEngine::onFileLoaded(const KLFile * file)
+{
+  m_changeTracked = true;
+}
+
+void KLCompletionEngine::onFileParsed(const KLFile * file)
+{
+  m_pendingFiles.insert(file);
+  m_changeTracked = true;
+}
+
+void KLCompletionEngine::onASTChanged()
+{
+  if(!m_changeTracked)
+    m_needsRebuild = true;
+  m_changeTracked = false;
+  m_indexRevision = getASTManager()->getASTRevision();
+}
+
+void KLCompletionEngine::validateIndex()
+{
+  // decls might have been replaced without any notification
+  if(getASTManager()->getASTRevision() != m_indexRevision)
+    m_needsRebuild = true;
+
+  if(m_needsRebuild)
+  {
+    m_index.clear();
+    std::vector<const KLExtension*> extensions = getASTManager()->getExtensions();
+    for(size_t i=0;i<extensions.size();i++)
+    {
+      std::vector<const KLFile*> files = extensions[i]->getFiles();
+      for(size_t j=0;j<files.size();j++)
+        collectEntries(files[j], m_index);
+    }
+    std::sort(m_index.begin(), m_index.end());
+  }
+  else if(m_pendingFiles.size() > 0)
+  {
+    // drop the entries of the parsed files and merge their new ones in
+    size_t count = 0;
+    for(size_t i=0;i<m_index.size();i++)
+    {
+      if(m_pendingFiles.find(m_index[i].file) != m_pendingFiles.end())
+        continue;
+      if(count != i)
+        m_index[count] = m_index[i];
+      count++;
+    }
+    m_index.resize(count);
+
+    std::vector<Entry> entries;
+    for(std::set<const KLFile*>::const_iterator it = m_pendingFiles.begin(); it != m_pendingFiles.end(); it++)
+      collectEntries(*it, entries);
+    std::sort(entries.begin(), entries.end());
+
+    m_index.insert(m_index.end(), entries.begin(), entries.end());
+    std::inplace_merge(m_index.begin(), m_index.begin() + count, m_index.end());
+  }
+
+  m_pendingFiles.clear();
+  m_needsRebuild = false;
+  m_indexRevision = getASTManager()->getASTRevision();
+}
+
+void KLCompletionEngine::collectEntries(const KLFile * file, std::vector<Entry> & entries) const
+{
+  Entry entry;
+  entry.file = file;
+
+  std::vector<const KLType*> types = file->getTypes();
+  for(size_t i=0;i<types.size();i++)
+  {
+    entry.name = types[i]->getName();
+    entry.kind = Kind_Type;
+    entry.decl = types[i];
+    entry.key = KLCompletionLower(entry.name);
+    entries.push_back(entry);
+  }
+
+  std::vector<const KLFunction*> functions = file->getFunctions();
+  for(size_t i=0;i<functions.size();i++)
+  {
+    // methods are offered after a '.' only
+    if(functions[i]->isOfDeclType(KLDeclType_Method))
+      continue;
+    entry.name = functions[i]->getName();
+    entry.kind = Kind_Function;
+    entry.decl = functions[i];
+    entry.key = KLCompletionLower(entry.name);
+    entries.push_back(entry);
+  }
+
+  std::vector<const KLConstant*> constants = file->getConstants();
+  for(size_t i=0;i<constants.size();i++)
+  {
+    entry.name = constants[i]->getName();
+    entry.kind = Kind_Constant;
+    entry.decl = constants[i];
+    entry.key = KLCompletionLower(entry.name);
+    entries.push_back(entry);
+  }
+
+  std::vector<const KLAlias*> aliases = file->getAliases();
+  for(size_t i=0;i<aliases.size();i++)
+  {
+    entry.name = aliases[i]->getNewUserName();
+    entry.kind = Kind_Alias;
+    entry.decl = aliases[i];
+    entry.key = KLCompletionLower(entry.name);
+    entries.push_back(entry);
+  }
+}
+
+int32_t KLCompletionEngine::scoreName(const std::string & name, const std::string & prefix)
+{
+  // prefers exact and case sensitive matches, then shorter names
+  int32_t score = -(int32_t)(name.length() - prefix.length());
+  if(name.length() == prefix.length())
+    score += KLCOMPLETION_SCORE_EXACT;
+  if(name.compare(0, prefix.length(), prefix) == 0)
+    score += KLCOMPLETION_SCORE_CASE;
+  if(name.length() > 0 && name[0] == '_' && (prefix.length() == 0 || prefix[0] != '_'))
+    score += KLCOMPLETION_SCORE_UNDERSCORE;
+  return score;
+}
+
+void KLCompletionEngine::rank(std::vector<Candidate> & candidates, uint32_t maxCount)
+{
+  if(candidates.size() > maxCount)
+  {
+    std::partial_sort(candidates.begin(), candidates.begin() + maxCount, candidates.end(), KLCompletionCandidateLess);
+    candidates.resize(maxCount);
+  }
+  else
+    std::sort(candidates.begin(), candidates.end(), KLCompletionCandidateLess);
+}
+
+std::vector<KLCompletionEngine::Candidate> KLCompletionEngine::getCandidates(const std::string & prefix, uint32_t maxCount)
+{
+  std::vector<Candidate> result;
+  if(!hasASTManager())
+    return result;
+  addGlobalCandidates(prefix, result);
+  rank(result, maxCount);
+  return result;
+}
+
+void KLCompletionEngine::addGlobalCandidates(const std::string & prefix, std::vector<Candidate> & candidates)
+{
+  validateIndex();
+
+  const KLFile * currentFile = m_assistant->getKLFile();
+
+  Entry first;
+  first.key = KLCompletionLower(prefix);
+  first.kind = Kind_Variable;
+  std::vector<Entry>::const_iterator it = std::lower_bound(m_index.begin(), m_index.end(), first);
+
+  const Entry * previous = NULL;
+  for(; it != m_index.end(); it++)
+  {
+    if(it->key.compare(0, first.key.length(), first.key) != 0)
+      break;
+
+    // overloads and duplicate declarations are offered once
+    if(previous && previous->kind == it->kind && previous->name == it->name)
+      continue;
+    previous = &(*it);
+
+    Candidate candidate;
+    candidate.name = it->name;
+    candidate.kind = it->kind;
+    candidate.decl = it->decl;
+    candidate.score = scoreName(it->name, prefix);
+    if(it->file == currentFile)
+      candidate.score += KLCOMPLETION_SCORE_CURRENT_FILE;
+    if(it->kind == Kind_Function)
+      candidate.type = ((const KLFunction*)it->decl)->getReturnType();
+    else if(it->kind == Kind_Constant)
+      candidate.type = ((const KLConstant*)it->decl)->getType();
+    else if(it->kind == Kind_Alias)
+      candidate.type = ((const KLAlias*)it->decl)->getOldUserName();
+    candidates.push_back(candidate);
+  }
+}
+
+void KLCompletionEngine::addMemberCandidates(const KLType * type, const std::string & prefix, std::vector<Candidate> & candidates) const
+{
+  std::string lowerPrefix = KLCompletionLower(prefix);
+  std::set<std::string> seen;
+
+  if(type->getDeclType() != KLDeclType_Interface)
+  {
+    const KLStruct * structType = (const KLStruct *)type;
+    uint32_t count = structType->getMemberCount(true);
+    for(uint32_t i=0;i<count;i++)
+    {
+      const KLMember * member = structType->getMember(i, true);
+      if(!KLCompletionHasPrefix(member->getName(), lowerPrefix))
+        continue;
+      if(!seen.insert(member->getName()).second)
+        continue;
+
+      Candidate candidate;
+      candidate.name = member->getName();
+      candidate.kind = Kind_Member;
+      candidate.decl = member;
+      candidate.type = member->getType();
+      candidate.score = scoreName(candidate.name, prefix);
+      candidates.push_back(candidate);
+    }
+  }
+
+  std::vector<const KLMethod*> methods = type->getMethods(true, false);
+  for(size_t i=0;i<methods.size();i++)
+  {
+    const KLMethod * method = methods[i];
+    if(method == NULL)
+      continue;
+    if(!KLCompletionHasPrefix(method->getName(), lowerPrefix))
+      continue;
+    if(!seen.insert(method->getName()).second)
+      continue;
+
+    Candidate candidate;
+    candidate.name = method->getName();
+    candidate.kind = Kind_Method;
+    candidate.decl = method;
+    candidate.type = method->getReturnType();
+    candidate.score = scoreName(candidate.name, prefix);
+    candidates.push_back(candidate);
+  }
+}
+
+std::vector<KLCompletionEngine::Candidate> KLCompletionEngine::getCandidatesAtCursor(uint32_t cursor, uint32_t maxCount)
+{
+  std::vector<Candidate> result;
+  if(!hasASTManager())
+    return result;
+
+  const std::string & code = m_assistant->getCode();
+  if(cursor > code.length())
+    cursor = code.length();
+  if(m_assistant->isCursorInsideCommentOrString(cursor))
+    return result;
+
+  uint32_t start = cursor;
+  while(start > 0 && (isalnum(code[start-1]) || code[start-1] == '_'))
+    start--;
+  std::string prefix = code.substr(start, cursor - start);
+
+  // skip whitespace between the dot and the prefix
+  uint32_t dot = start;
+  while(dot > 0 && (code[dot-1] == ' ' || code[dot-1] == '\t'))
+    dot--;
+
+  if(dot > 1 && code[dot-1] == '.')
+  {
+    const KLType * type = m_assistant->getTypeAtCursor(dot - 2);
+    if(type)
+      addMemberCandidates(type, prefix, result);
+    rank(result, maxCount);
+    return result;
+  }
+
+  // a number isn't a symbol
+  if(prefix.length() > 0 && isdigit(prefix[0]))
+    return result;
+
+  std::string lowerPrefix = KLCompletionLower(prefix);
+  const KLFunction * function = m_assistant->getFunctionAtCursor(cursor);
+  if(function)
+  {
+    uint32_t line, column;
+    m_assistant->cursorToLineAndColumn(cursor, line, column);
+
+    // innermost first, so shadowed variables are skipped
+    std::set<std::string> variableNames;
+    uint32_t count = function->getLocalVariablesDeclaredBefore(line, column);
+    for(uint32_t i=count;i>0;i--)
+    {
+      const KLLocalVariable & variable = function->getLocalVariable(i-1);
+      if(!KLCompletionHasPrefix(variable.name, lowerPrefix))
+        continue;
+      if(!variable.isVisibleAt(line, column))
+        continue;
+      if(!variableNames.insert(variable.name).second)
+        continue;
+
+      Candidate candidate;
+      candidate.name = variable.name;
+      candidate.kind = Kind_Variable;
+      candidate.decl = NULL;
+      candidate.type = variable.type + variable.arrayModifier;
+      candidate.score = scoreName(variable.name, prefix) + KLCOMPLETION_SCORE_VARIABLE;
+      result.push_back(candidate);
+    }
+  }
+
+  addGlobalCandidates(prefix, result);
+  rank(result, maxCount);
+  return result;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __CodeCompletion_KLCompletionEngine__
+#define __CodeCompletion_KLCompletionEngine__
+
+#include "KLCodeAssistant.h"
+#include <set>
+
+namespace FabricServices
+{
+
+  namespace CodeCompletion
+  {
+
+    // Ranks completion candidates for the code of a KLCodeAssistant.
+    // All global symbols (types, functions, constants and aliases) are
+    // kept in an index sorted by their lower case name, so the candidates
+    // for a prefix are a contiguous range of it. The index is maintained
+    // per file: a parsed file only replaces its own entries, a full
+    // rebuild only happens when the AST changed in an untracked way.
+    // Members and methods after a '.' are resolved through the
+    // assistant's getTypeAtCursor, local variables through the scope
+    // table of the function at the cursor.
+    class KLCompletionEngine : public ASTWrapper::KLASTClient
+    {
+    public:
+
+      enum Kind
+      {
+        Kind_Variable,
+        Kind_Type,
+        Kind_Function,
+        Kind_Method,
+        Kind_Member,
+        Kind_Constant,
+        Kind_Alias,
+        Kind_NumItems
+      };
+
+      struct Candidate
+      {
+        std::string name;
+        Kind kind;
+        // the decl of the candidate, NULL for local variables
+        const ASTWrapper::KLDecl * decl;
+        // the type of variables and members, the return type of functions
+        std::string type;
+        int32_t score;
+      };
+
+      KLCompletionEngine(KLCodeAssistant * assistant);
+      virtual ~KLCompletionEngine();
+
+      static const char * getKindName(Kind kind);
+
+      // returns the best candidates completing the word ending at the cursor,
+      // best first. the prefix is the part of the word in front of the cursor.
+      std::vector<Candidate> getCandidatesAtCursor(uint32_t cursor, uint32_t maxCount = 50);
+      // returns the best global symbols starting with the given prefix
+      std::vector<Candidate> getCandidates(const std::string & prefix, uint32_t maxCount = 50);
+
+      virtual bool setASTManager(ASTWrapper::KLASTManager * manager);
+
+      virtual void onExtensionLoaded(const ASTWrapper::KLExtension * extension);
+      virtual void onExtensionParsed(const ASTWrapper::KLExtension * extension);
+      virtual void onFileLoaded(const ASTWrapper::KLFile * file);
+      virtual void onFileParsed(const ASTWrapper::KLFile * file);
+      virtual void onASTChanged();
+
+    private:
+
+      struct Entry
+      {
+        std::string key;
+        std::string name;
+        Kind kind;
+        const ASTWrapper::KLDecl * decl;
+        const ASTWrapper::KLFile * file;
+
+        bool operator < (const Entry & other) const;
+      };
+
+      void validateIndex();
+      void collectEntries(const ASTWrapper::KLFile * file, std::vector<Entry> & entries) const;
+      void addGlobalCandidates(const std::string & prefix, std::vector<Candidate> & candidates);
+      void addMemberCandidates(const ASTWrapper::KLType * type, const std::string & prefix, std::vector<Candidate> & candidates) const;
+      static int32_t scoreName(const std::string & name, const std::string & prefix);
+      static void rank(std::vector<Candidate> & candidates, uint32_t maxCount);
+
+      KLCodeAssistant * m_assistant;
+
+      std::vector<Entry> m_index;
+      bool m_needsRebuild;
+      // the AST revision the index reflects, apart from m_pendingFiles
+      uint32_t m_indexRevision;
+      // true while the notifications since the last onASTChanged
+      // describe the change completely
+      bool m_changeTracked;
+      std::set<const ASTWrapper::KLFile*> m_pendingFiles;
+    };
+
+  };
+
+};
+
+
+#endif // __CodeCompletion_KLCompletionEngine__
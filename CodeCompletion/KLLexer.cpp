@@ -0,0 +1,249 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLLexer.h"
+
+#include <string.h>
+#include <ctype.h>
+
+using namespace FabricServices::CodeCompletion;
+
+enum KLLexerCharClass
+{
+  KLLexerCharClass_Other,
+  KLLexerCharClass_Space,
+  KLLexerCharClass_Alpha,
+  KLLexerCharClass_Digit,
+  KLLexerCharClass_Quote,
+  KLLexerCharClass_Slash,
+  KLLexerCharClass_Dot
+};
+
+// the character class table, filled in once on load
+struct KLLexerCharTable
+{
+  uint8_t classes[256];
+
+  KLLexerCharTable()
+  {
+    memset(classes, KLLexerCharClass_Other, sizeof(classes));
+    classes[(uint8_t)' '] = KLLexerCharClass_Space;
+    classes[(uint8_t)'\t'] = KLLexerCharClass_Space;
+    classes[(uint8_t)'\r'] = KLLexerCharClass_Space;
+    classes[(uint8_t)'\n'] = KLLexerCharClass_Space;
+    classes[(uint8_t)'\v'] = KLLexerCharClass_Space;
+    classes[(uint8_t)'\f'] = KLLexerCharClass_Space;
+    for(int c='a';c<='z';c++)
+      classes[c] = KLLexerCharClass_Alpha;
+    for(int c='A';c<='Z';c++)
+      classes[c] = KLLexerCharClass_Alpha;
+    classes[(uint8_t)'_'] = KLLexerCharClass_Alpha;
+    for(int c='0';c<='9';c++)
+      classes[c] = KLLexerCharClass_Digit;
+    classes[(uint8_t)'"'] = KLLexerCharClass_Quote;
+    classes[(uint8_t)'\''] = KLLexerCharClass_Quote;
+    classes[(uint8_t)'/'] = KLLexerCharClass_Slash;
+    classes[(uint8_t)'.'] = KLLexerCharClass_Dot;
+  }
+};
+
+static const KLLexerCharTable s_charTable;
+
+#define KLLEXER_CLASS(c) (s_charTable.classes[(uint8_t)(c)])
+#define KLLEXER_IS_IDENT(c) (KLLEXER_CLASS(c) == KLLexerCharClass_Alpha || KLLEXER_CLASS(c) == KLLexerCharClass_Digit)
+
+// sorted, for the binary search in isKeyword
+static const char * s_keywords[] = {
+  "alias",
+  "break",
+  "case",
+  "const",
+  "continue",
+  "default",
+  "do",
+  "else",
+  "false",
+  "for",
+  "function",
+  "if",
+  "in",
+  "inline",
+  "interface",
+  "io",
+  "null",
+  "object",
+  "operator",
+  "permits",
+  "private",
+  "protected",
+  "public",
+  "require",
+  "return",
+  "struct",
+  "switch",
+  "this",
+  "true",
+  "while"
+};
+
+KLLexer::KLLexer(const char * text, uint32_t length)
+{
+  m_text = text;
+  m_length = length;
+  m_pos = 0;
+}
+
+bool KLLexer::isKeyword(const char * word, uint32_t length)
+{
+  int32_t low = 0;
+  int32_t high = (int32_t)(sizeof(s_keywords) / sizeof(s_keywords[0])) - 1;
+  while(low <= high)
+  {
+    int32_t mid = (low + high) / 2;
+    int result = strncmp(s_keywords[mid], word, length);
+    if(result == 0 && s_keywords[mid][length] != '\0')
+      result = 1;
+    if(result == 0)
+      return true;
+    if(result < 0)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+  return false;
+}
+
+void KLLexer::skipNumber()
+{
+  // hexadecimal
+  if(m_text[m_pos] == '0' && m_pos + 1 < m_length && (m_text[m_pos+1] == 'x' || m_text[m_pos+1] == 'X'))
+  {
+    m_pos += 2;
+    while(m_pos < m_length && isxdigit((uint8_t)m_text[m_pos]))
+      m_pos++;
+    return;
+  }
+
+  while(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Digit)
+    m_pos++;
+  if(m_pos + 1 < m_length && m_text[m_pos] == '.' && KLLEXER_CLASS(m_text[m_pos+1]) == KLLexerCharClass_Digit)
+  {
+    m_pos++;
+    while(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Digit)
+      m_pos++;
+  }
+  if(m_pos < m_length && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E'))
+  {
+    uint32_t exponent = m_pos + 1;
+    if(exponent < m_length && (m_text[exponent] == '+' || m_text[exponent] == '-'))
+      exponent++;
+    if(exponent < m_length && KLLEXER_CLASS(m_text[exponent]) == KLLexerCharClass_Digit)
+    {
+      m_pos = exponent;
+      while(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Digit)
+        m_pos++;
+    }
+  }
+}
+
+KLSyntaxHighlighter::Token KLLexer::getNext(uint32_t * start, uint32_t * end)
+{
+  *start = m_pos;
+  if(m_pos >= m_length)
+  {
+    *end = m_pos;
+    return KLSyntaxHighlighter::Token_EOF;
+  }
+
+  KLSyntaxHighlighter::Token token = KLSyntaxHighlighter::Token_Other;
+  char c = m_text[m_pos];
+  switch(KLLEXER_CLASS(c))
+  {
+    case KLLexerCharClass_Space:
+    {
+      m_pos++;
+      while(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Space)
+        m_pos++;
+      break;
+    }
+    case KLLexerCharClass_Alpha:
+    {
+      m_pos++;
+      while(m_pos < m_length && KLLEXER_IS_IDENT(m_text[m_pos]))
+        m_pos++;
+      if(isKeyword(m_text + *start, m_pos - *start))
+        token = KLSyntaxHighlighter::Token_Keyword;
+      break;
+    }
+    case KLLexerCharClass_Digit:
+    {
+      skipNumber();
+      token = KLSyntaxHighlighter::Token_Number;
+      break;
+    }
+    case KLLexerCharClass_Dot:
+    {
+      // a fraction without a leading zero, like .5
+      m_pos++;
+      if(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Digit)
+      {
+        while(m_pos < m_length && KLLEXER_CLASS(m_text[m_pos]) == KLLexerCharClass_Digit)
+          m_pos++;
+        token = KLSyntaxHighlighter::Token_Number;
+      }
+      break;
+    }
+    case KLLexerCharClass_Quote:
+    {
+      m_pos++;
+      while(m_pos < m_length && m_text[m_pos] != c && m_text[m_pos] != '\n')
+      {
+        if(m_text[m_pos] == '\\' && m_pos + 1 < m_length)
+          m_pos++;
+        m_pos++;
+      }
+      if(m_pos < m_length && m_text[m_pos] == c)
+        m_pos++;
+      token = KLSyntaxHighlighter::Token_String;
+      break;
+    }
+    case KLLexerCharClass_Slash:
+    {
+      m_pos++;
+      if(m_pos < m_length && m_text[m_pos] == '/')
+      {
+        const char * lineEnd = (const char *)memchr(m_text + m_pos, '\n', m_length - m_pos);
+        m_pos = lineEnd ? (uint32_t)(lineEnd - m_text) : m_length;
+        token = KLSyntaxHighlighter::Token_Comment;
+      }
+      else if(m_pos < m_length && m_text[m_pos] == '*')
+      {
+        m_pos++;
+        for(;;)
+        {
+          const char * star = (const char *)memchr(m_text + m_pos, '*', m_length - m_pos);
+          if(!star)
+          {
+            m_pos = m_length;
+            break;
+          }
+          m_pos = (uint32_t)(star - m_text) + 1;
+          if(m_pos < m_length && m_text[m_pos] == '/')
+          {
+            m_pos++;
+            break;
+          }
+        }
+        token = KLSyntaxHighlighter::Token_Comment;
+      }
+      break;
+    }
+    default:
+    {
+      m_pos++;
+      break;
+    }
+  }
+
+  *end = m_pos;
+  return token;
+}
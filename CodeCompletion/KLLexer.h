@@ -0,0 +1,46 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __CodeCompletion_KLLexer__
+#define __CodeCompletion_KLLexer__
+
+#include "KLSyntaxHighlighter.h"
+
+namespace FabricServices
+{
+
+  namespace CodeCompletion
+  {
+
+    // A table driven lexer for KL, producing the same token classes as
+    // FabricCore::KLTokenStream without calling into the core. Every
+    // character of the text is looked up once in a character class
+    // table, runs of whitespace and identifier characters are consumed
+    // in tight loops. Whitespace, identifiers and punctuation are all
+    // reported as Token_Other, like the core does. Unterminated comments
+    // and strings extend to the end of the text or line respectively.
+    class KLLexer
+    {
+    public:
+
+      KLLexer(const char * text, uint32_t length);
+
+      // returns the next token and its [start, end) range,
+      // Token_EOF once the end of the text is reached.
+      KLSyntaxHighlighter::Token getNext(uint32_t * start, uint32_t * end);
+
+      static bool isKeyword(const char * word, uint32_t length);
+
+    private:
+
+      void skipNumber();
+
+      const char * m_text;
+      uint32_t m_length;
+      uint32_t m_pos;
+    };
+
+  };
+
+};
+
+#endif // __CodeCompletion_KLLexer__
@@ -0,0 +1,129 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLParseWorker.h"
+#include <ASTWrapper/KLFile.h>
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::CodeCompletion;
+using namespace FabricServices::Threading;
+
+KLParseWorker::KLParseWorker(const FabricCore::Client * client, uint32_t debounceMilliseconds)
+{
+  m_client = client;
+  m_debounce = debounceMilliseconds;
+  m_stop = false;
+  m_hasRequest = false;
+  m_requestRevision = 0;
+  m_requestTime = 0;
+  m_requestDFGExec = NULL;
+  m_hasResult = false;
+  m_resultRevision = 0;
+}
+
+KLParseWorker::~KLParseWorker()
+{
+  stop();
+}
+
+uint32_t KLParseWorker::getDebounceMilliseconds() const
+{
+  return m_debounce;
+}
+
+void KLParseWorker::request(uint32_t revision, const std::string & fileName, const std::string & code, FabricCore::DFGExec * dfgExec)
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_hasRequest = true;
+    m_requestRevision = revision;
+    m_requestTime = Thread::getMilliseconds();
+    m_requestFileName = fileName;
+    m_requestCode = code;
+    m_requestDFGExec = dfgExec;
+    m_condition.wakeAll();
+  }
+
+  if(!isRunning())
+    start();
+}
+
+bool KLParseWorker::hasPendingRequest(uint32_t revision)
+{
+  MutexLocker locker(m_mutex);
+  return m_hasRequest && m_requestRevision == revision;
+}
+
+bool KLParseWorker::takeResult(uint32_t & revision, std::string & code, std::string & jsonAST)
+{
+  MutexLocker locker(m_mutex);
+  if(!m_hasResult)
+    return false;
+  m_hasResult = false;
+  revision = m_resultRevision;
+  code.swap(m_resultCode);
+  jsonAST.swap(m_resultJSONAST);
+  m_resultCode.clear();
+  m_resultJSONAST.clear();
+  return true;
+}
+
+void KLParseWorker::stop()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_condition.wakeAll();
+  }
+  join();
+
+  MutexLocker locker(m_mutex);
+  m_stop = false;
+}
+
+void KLParseWorker::run()
+{
+  m_mutex.lock();
+  for(;;)
+  {
+    while(!m_stop && !m_hasRequest)
+      m_condition.wait(m_mutex);
+    if(m_stop)
+      break;
+
+    // wait until the edits have settled. a newer request
+    // moves the request time and extends the wait.
+    uint64_t now = Thread::getMilliseconds();
+    if(now - m_requestTime < m_debounce)
+    {
+      m_condition.wait(m_mutex, (uint32_t)(m_debounce - (now - m_requestTime)));
+      continue;
+    }
+
+    uint32_t revision = m_requestRevision;
+    std::string fileName, code;
+    fileName.swap(m_requestFileName);
+    code.swap(m_requestCode);
+    FabricCore::DFGExec * dfgExec = m_requestDFGExec;
+    m_hasRequest = false;
+    m_mutex.unlock();
+
+    // an empty AST makes the KLFile run the compiler itself when the
+    // result is applied, which reports the failure on the owner's thread.
+    std::string jsonAST;
+    try
+    {
+      jsonAST = KLFile::generateJSONAST(m_client, dfgExec, fileName.c_str(), code.c_str());
+    }
+    catch(FabricCore::Exception e)
+    {
+      printf("[KLParseWorker] Exception while parsing '%s': %s\n", fileName.c_str(), e.getDesc_cstr());
+    }
+
+    m_mutex.lock();
+    m_hasResult = true;
+    m_resultRevision = revision;
+    m_resultCode.swap(code);
+    m_resultJSONAST.swap(jsonAST);
+  }
+  m_mutex.unlock();
+}
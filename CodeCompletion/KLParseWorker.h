@@ -0,0 +1,71 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __CodeCompletion_KLParseWorker__
+#define __CodeCompletion_KLParseWorker__
+
+#include <Threading/Thread.h>
+#include <FabricCore.h>
+#include <string>
+
+namespace FabricServices
+{
+
+  namespace CodeCompletion
+  {
+
+    // Runs the KL compiler for a KLCodeAssistant on a background thread.
+    // Requests are debounced: the compiler only runs once no new request
+    // has come in for the debounce interval, and only the latest request
+    // is compiled. The worker never touches the AST itself, it only
+    // produces the compiler's JSON output. The owner picks the result up
+    // on its own thread through takeResult and applies it there.
+    class KLParseWorker : public Threading::Thread
+    {
+    public:
+
+      KLParseWorker(const FabricCore::Client * client, uint32_t debounceMilliseconds = 300);
+      virtual ~KLParseWorker();
+
+      uint32_t getDebounceMilliseconds() const;
+
+      // queues the code for compilation, replacing any pending request.
+      // the revision is handed back with the result so that the owner
+      // can tell whether the code has been edited since.
+      void request(uint32_t revision, const std::string & fileName, const std::string & code, FabricCore::DFGExec * dfgExec = NULL);
+      bool hasPendingRequest(uint32_t revision);
+
+      // returns false if no new result is available
+      bool takeResult(uint32_t & revision, std::string & code, std::string & jsonAST);
+
+      void stop();
+
+    protected:
+
+      virtual void run();
+
+    private:
+
+      const FabricCore::Client * m_client;
+      uint32_t m_debounce;
+      bool m_stop;
+      Threading::Mutex m_mutex;
+      Threading::Condition m_condition;
+
+      bool m_hasRequest;
+      uint32_t m_requestRevision;
+      uint64_t m_requestTime;
+      std::string m_requestFileName;
+      std::string m_requestCode;
+      FabricCore::DFGExec * m_requestDFGExec;
+
+      bool m_hasResult;
+      uint32_t m_resultRevision;
+      std::string m_resultCode;
+      std::string m_resultJSONAST;
+    };
+
+  };
+
+};
+
+#endif // __CodeCompletion_KLParseWorker__
@@ -0,0 +1,399 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLSemanticTokens.h"
+#include "KLLexer.h"
+#include <ASTWrapper/KLASTManager.h>
+
+#include <algorithm>
+#include <ctype.h>
+
+using namespace FabricServices::ASTWrapper;
+using namespace FabricServices::CodeCompletion;
+using namespace FabricServices::Threading;
+
+static bool KLSemanticTokensDeclaredBefore(const KLLocalVariable & a, const KLLocalVariable & b)
+{
+  if(a.line != b.line)
+    return a.line < b.line;
+  return a.column < b.column;
+}
+
+bool KLSemanticTokens::Token::operator == (const Token & other) const
+{
+  return delta == other.delta && length == other.length && kind == other.kind;
+}
+
+KLSemanticTokens::KLSemanticTokens()
+{
+  m_stop = false;
+  m_hasRequest = false;
+  m_request.revision = 0;
+  m_hasResult = false;
+  m_result.revision = 0;
+  m_result.start = 0;
+  m_result.deleteCount = 0;
+}
+
+KLSemanticTokens::~KLSemanticTokens()
+{
+  stop();
+}
+
+const char * KLSemanticTokens::getKindName(Kind kind)
+{
+  switch(kind)
+  {
+    case Kind_Type:
+      return "Type";
+    case Kind_Function:
+      return "Function";
+    case Kind_Method:
+      return "Method";
+    case Kind_Member:
+      return "Member";
+    case Kind_Constant:
+      return "Constant";
+    case Kind_Parameter:
+      return "Parameter";
+    case Kind_Variable:
+      return "Variable";
+    default:
+      return "";
+  }
+}
+
+void KLSemanticTokens::request(uint32_t revision, const std::string & code, const KLFile * file, bool useCoreTokenStream)
+{
+  if(!file)
+    return;
+
+  Request request;
+  request.revision = revision;
+  request.code = code;
+
+  std::vector<const KLFunction*> functions = file->getFunctions();
+  for(size_t i=0;i<functions.size();i++)
+    addScope(functions[i], request.scopes);
+  std::vector<const KLMethod*> methods = file->getMethods();
+  for(size_t i=0;i<methods.size();i++)
+    addScope(methods[i], request.scopes);
+  std::vector<const KLOperator*> operators = file->getOperators();
+  for(size_t i=0;i<operators.size();i++)
+    addScope(operators[i], request.scopes);
+
+  // functions don't nest, sorting by start allows a binary search
+  std::sort(request.scopes.begin(), request.scopes.end(), ScopeStartsBefore);
+
+  // later insertions don't replace earlier ones, so a
+  // type shadows a function or constant of the same name
+  const KLASTManager * manager = file->getExtension() ? file->getExtension()->getASTManager() : NULL;
+
+  // the core client is only used on the calling thread
+  collectWords(request.code, useCoreTokenStream && manager ? manager->getClient() : NULL, request.words);
+
+  if(manager)
+  {
+    std::vector<const KLType*> types = manager->getTypes();
+    for(size_t i=0;i<types.size();i++)
+      request.globals.insert(std::pair<std::string, Kind>(types[i]->getName(), Kind_Type));
+    std::vector<const KLAlias*> aliases = manager->getAliases();
+    for(size_t i=0;i<aliases.size();i++)
+      request.globals.insert(std::pair<std::string, Kind>(aliases[i]->getNewUserName(), Kind_Type));
+
+    std::vector<std::string> basicTypes;
+    manager->getRegisteredTypeTable()->getTypeNames(0, basicTypes);
+    for(size_t i=0;i<basicTypes.size();i++)
+      request.globals.insert(std::pair<std::string, Kind>(basicTypes[i], Kind_Type));
+
+    std::vector<const KLConstant*> constants = manager->getConstants();
+    for(size_t i=0;i<constants.size();i++)
+      request.globals.insert(std::pair<std::string, Kind>(constants[i]->getName(), Kind_Constant));
+    std::vector<const KLFunction*> globalFunctions = manager->getFunctions();
+    for(size_t i=0;i<globalFunctions.size();i++)
+      request.globals.insert(std::pair<std::string, Kind>(globalFunctions[i]->getName(), Kind_Function));
+  }
+
+  {
+    MutexLocker locker(m_mutex);
+    m_hasRequest = true;
+    m_request.revision = request.revision;
+    m_request.code.swap(request.code);
+    m_request.words.swap(request.words);
+    m_request.scopes.swap(request.scopes);
+    m_request.globals.swap(request.globals);
+    m_condition.wakeAll();
+  }
+
+  if(!isRunning())
+    start();
+}
+
+bool KLSemanticTokens::takeDelta(Delta & delta)
+{
+  MutexLocker locker(m_mutex);
+  if(!m_hasResult)
+    return false;
+  m_hasResult = false;
+
+  delta.revision = m_result.revision;
+  delta.start = m_result.start;
+  delta.deleteCount = m_result.deleteCount;
+  delta.tokens.swap(m_result.tokens);
+  m_result.tokens.clear();
+  m_takenTokens.swap(m_resultTokens);
+  m_resultTokens.clear();
+  return true;
+}
+
+const std::vector<KLSemanticTokens::Token> & KLSemanticTokens::getTokens() const
+{
+  return m_takenTokens;
+}
+
+void KLSemanticTokens::stop()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_condition.wakeAll();
+  }
+  join();
+
+  MutexLocker locker(m_mutex);
+  m_stop = false;
+}
+
+void KLSemanticTokens::run()
+{
+  m_mutex.lock();
+  for(;;)
+  {
+    while(!m_stop && !m_hasRequest)
+      m_condition.wait(m_mutex);
+    if(m_stop)
+      break;
+
+    Request request;
+    request.revision = m_request.revision;
+    request.code.swap(m_request.code);
+    request.words.swap(m_request.words);
+    request.scopes.swap(m_request.scopes);
+    request.globals.swap(m_request.globals);
+    m_hasRequest = false;
+    m_mutex.unlock();
+
+    std::vector<Token> tokens;
+    classify(request, tokens);
+
+    m_mutex.lock();
+    // always against the version the owner has, even
+    // if a previous result has never been taken
+    computeDelta(m_takenTokens, tokens, m_result);
+    m_result.revision = request.revision;
+    m_resultTokens.swap(tokens);
+    m_hasResult = true;
+  }
+  m_mutex.unlock();
+}
+
+bool KLSemanticTokens::ScopeStartsBefore(const Scope & a, const Scope & b)
+{
+  if(a.line != b.line)
+    return a.line < b.line;
+  return a.column < b.column;
+}
+
+void KLSemanticTokens::addScope(const KLFunction * function, std::vector<Scope> & scopes)
+{
+  const KLLocation * location = function->getLocation();
+  if(!location)
+    return;
+
+  Scope scope;
+  scope.line = location->getLine();
+  scope.column = location->getColumn();
+  scope.endLine = location->getEndLine();
+  scope.endColumn = location->getEndColumn();
+  for(uint32_t i=0;i<function->getLocalVariableCount();i++)
+    scope.variables.push_back(function->getLocalVariable(i));
+
+  if(function->isMethod())
+  {
+    const KLMethod * method = (const KLMethod *)function;
+    const KLASTManager * manager = function->getASTManager();
+    const KLType * thisType = manager ? manager->getKLTypeByName(method->getThisType().c_str(), function) : NULL;
+    if(thisType)
+    {
+      if(thisType->isOfDeclType(KLDeclType_Struct))
+      {
+        const KLStruct * klStruct = (const KLStruct *)thisType;
+        for(uint32_t i=0;i<klStruct->getMemberCount(true);i++)
+          scope.members.insert(klStruct->getMember(i, true)->getName());
+      }
+      std::vector<const KLMethod*> methods = thisType->getMethods(true, true, 0, false);
+      for(size_t i=0;i<methods.size();i++)
+        scope.methods.insert(methods[i]->getName());
+    }
+  }
+
+  scopes.push_back(scope);
+}
+
+const KLSemanticTokens::Scope * KLSemanticTokens::findScope(const std::vector<Scope> & scopes, uint32_t line, uint32_t column)
+{
+  // the last function starting at or before the cursor
+  Scope cursor;
+  cursor.line = line;
+  cursor.column = column;
+  std::vector<Scope>::const_iterator it =
+    std::upper_bound(scopes.begin(), scopes.end(), cursor, ScopeStartsBefore);
+  if(it == scopes.begin())
+    return NULL;
+  it--;
+
+  if(it->endLine < line || (it->endLine == line && it->endColumn < column))
+    return NULL;
+  return &(*it);
+}
+
+void KLSemanticTokens::collectWords(const std::string & code, const FabricCore::Client * client, std::vector<Word> & words)
+{
+  const char * text = code.c_str();
+  uint32_t length = (uint32_t)code.length();
+
+  // the identifiers and punctuation of the code, without
+  // whitespace, comments, strings, numbers and keywords
+  KLLexer lexer(text, length);
+  FabricCore::KLTokenStream * klTokenStream = NULL;
+  if(client)
+    klTokenStream = new FabricCore::KLTokenStream(FabricCore::KLTokenStream::Create(*client, text, length));
+
+  for(;;)
+  {
+    Word word;
+    KLSyntaxHighlighter::Token token;
+    if(klTokenStream)
+      token = (KLSyntaxHighlighter::Token)(int)klTokenStream->getNext(&word.start, &word.end);
+    else
+      token = lexer.getNext(&word.start, &word.end);
+    if(token == KLSyntaxHighlighter::Token_EOF)
+      break;
+    if(token != KLSyntaxHighlighter::Token_Other || isspace((uint8_t)text[word.start]))
+      continue;
+    words.push_back(word);
+  }
+
+  delete(klTokenStream);
+}
+
+void KLSemanticTokens::classify(const Request & request, std::vector<Token> & tokens)
+{
+  const char * text = request.code.c_str();
+  const std::vector<Word> & words = request.words;
+
+  uint32_t line = 1;
+  uint32_t lineStart = 0;
+  uint32_t newLinesUpTo = 0;
+  uint32_t previousStart = 0;
+
+  for(size_t i=0;i<words.size();i++)
+  {
+    const Word & word = words[i];
+    char c = text[word.start];
+    if(!(isalpha((uint8_t)c) || c == '_'))
+      continue;
+
+    // advance the line counter to the identifier
+    for(;newLinesUpTo<word.start;newLinesUpTo++)
+    {
+      if(text[newLinesUpTo] == '\n')
+      {
+        line++;
+        lineStart = newLinesUpTo + 1;
+      }
+    }
+    uint32_t column = word.start - lineStart + 1;
+
+    std::string name(text + word.start, word.end - word.start);
+    bool afterDot = i > 0 && text[words[i-1].start] == '.' && words[i-1].end == words[i-1].start + 1;
+    // method declarations put a '!' or '?' between the name and the '('
+    size_t next = i + 1;
+    if(next < words.size() && (text[words[next].start] == '!' || text[words[next].start] == '?'))
+      next++;
+    bool beforeCall = next < words.size() && text[words[next].start] == '(';
+
+    Kind kind = Kind_NumItems;
+    if(afterDot)
+    {
+      // the type in front of the dot isn't known here, but
+      // anything accessed through a dot is a member or method
+      kind = beforeCall ? Kind_Method : Kind_Member;
+    }
+    else
+    {
+      const Scope * scope = findScope(request.scopes, line, column);
+      if(scope)
+      {
+        // the innermost visible variable declared before the identifier
+        KLLocalVariable cursor;
+        cursor.line = line;
+        cursor.column = column;
+        std::vector<KLLocalVariable>::const_iterator it =
+          std::upper_bound(scope->variables.begin(), scope->variables.end(), cursor, KLSemanticTokensDeclaredBefore);
+        while(it != scope->variables.begin())
+        {
+          it--;
+          if(it->name == name && it->isVisibleAt(line, column))
+          {
+            kind = it->isParameter ? Kind_Parameter : Kind_Variable;
+            break;
+          }
+        }
+
+        if(kind == Kind_NumItems)
+        {
+          if(beforeCall && scope->methods.find(name) != scope->methods.end())
+            kind = Kind_Method;
+          else if(scope->members.find(name) != scope->members.end())
+            kind = Kind_Member;
+        }
+      }
+
+      if(kind == Kind_NumItems)
+      {
+        std::map<std::string, Kind>::const_iterator it = request.globals.find(name);
+        if(it != request.globals.end())
+          kind = it->second;
+      }
+    }
+
+    if(kind == Kind_NumItems)
+      continue;
+
+    Token token;
+    token.delta = word.start - previousStart;
+    token.length = word.end - word.start;
+    token.kind = kind;
+    tokens.push_back(token);
+    previousStart = word.start;
+  }
+}
+
+void KLSemanticTokens::computeDelta(const std::vector<Token> & before, const std::vector<Token> & after, Delta & delta)
+{
+  // since the tokens are relative, an edit only changes the tokens
+  // around it and the unchanged head and tail can be kept
+  size_t prefix = 0;
+  size_t maxPrefix = std::min(before.size(), after.size());
+  while(prefix < maxPrefix && before[prefix] == after[prefix])
+    prefix++;
+
+  size_t suffix = 0;
+  size_t maxSuffix = maxPrefix - prefix;
+  while(suffix < maxSuffix && before[before.size() - suffix - 1] == after[after.size() - suffix - 1])
+    suffix++;
+
+  delta.start = (uint32_t)prefix;
+  delta.deleteCount = (uint32_t)(before.size() - prefix - suffix);
+  delta.tokens.assign(after.begin() + prefix, after.end() - suffix);
+}
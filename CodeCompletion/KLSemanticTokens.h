@@ -0,0 +1,146 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __CodeCompletion_KLSemanticTokens__
+#define __CodeCompletion_KLSemanticTokens__
+
+#include <Threading/Thread.h>
+#include <ASTWrapper/KLFunction.h>
+#include <ASTWrapper/KLFile.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace FabricServices
+{
+
+  namespace CodeCompletion
+  {
+
+    // Classifies the identifiers of a parsed KL file from its AST, which
+    // the KLSyntaxHighlighter's global name table can't do: parameters
+    // and local variables are looked up in the scope table of the
+    // enclosing function, members and methods of the this type are told
+    // apart from globals of the same name. What is needed of the AST is
+    // copied on the calling thread, the identifiers are classified once
+    // per parse on a background thread.
+    //
+    // The tokens are relative, each one starts delta characters after the
+    // start of the previous one, so an edit only changes the tokens close
+    // to it. A new version is handed out as a single Delta against the
+    // version taken before, replacing deleteCount tokens at index start.
+    class KLSemanticTokens : public Threading::Thread
+    {
+    public:
+
+      enum Kind
+      {
+        Kind_Type,
+        Kind_Function,
+        Kind_Method,
+        Kind_Member,
+        Kind_Constant,
+        Kind_Parameter,
+        Kind_Variable,
+        Kind_NumItems
+      };
+
+      struct Token
+      {
+        uint32_t delta;
+        uint32_t length;
+        Kind kind;
+
+        bool operator == (const Token & other) const;
+      };
+
+      struct Delta
+      {
+        uint32_t revision;
+        uint32_t start;
+        uint32_t deleteCount;
+        std::vector<Token> tokens;
+      };
+
+      KLSemanticTokens();
+      virtual ~KLSemanticTokens();
+
+      static const char * getKindName(Kind kind);
+
+      // snapshots the scopes of the file and the global names of its
+      // manager, replacing any pending request. the code has to be
+      // the code the file was parsed from. the identifiers are taken
+      // from the same tokenizer as the KLSyntaxHighlighter uses, see
+      // KLSyntaxHighlighter::getUseCoreTokenStream.
+      void request(uint32_t revision, const std::string & code, const ASTWrapper::KLFile * file, bool useCoreTokenStream);
+
+      // returns false if no new version is available. the delta applies
+      // to the tokens returned by getTokens before the call.
+      bool takeDelta(Delta & delta);
+      // the tokens of the version taken last
+      const std::vector<Token> & getTokens() const;
+
+      void stop();
+
+    protected:
+
+      virtual void run();
+
+    private:
+
+      // an identifier or punctuation character of the code
+      struct Word
+      {
+        uint32_t start;
+        uint32_t end;
+      };
+
+      // the scope table of a function together with the
+      // members and methods of its this type
+      struct Scope
+      {
+        uint32_t line;
+        uint32_t column;
+        uint32_t endLine;
+        uint32_t endColumn;
+        std::vector<ASTWrapper::KLLocalVariable> variables;
+        std::set<std::string> members;
+        std::set<std::string> methods;
+      };
+
+      struct Request
+      {
+        uint32_t revision;
+        std::string code;
+        std::vector<Word> words;
+        std::vector<Scope> scopes;
+        std::map<std::string, Kind> globals;
+      };
+
+      static bool ScopeStartsBefore(const Scope & a, const Scope & b);
+      static void addScope(const ASTWrapper::KLFunction * function, std::vector<Scope> & scopes);
+      static void collectWords(const std::string & code, const FabricCore::Client * client, std::vector<Word> & words);
+      static void classify(const Request & request, std::vector<Token> & tokens);
+      static const Scope * findScope(const std::vector<Scope> & scopes, uint32_t line, uint32_t column);
+      static void computeDelta(const std::vector<Token> & before, const std::vector<Token> & after, Delta & delta);
+
+      bool m_stop;
+      Threading::Mutex m_mutex;
+      Threading::Condition m_condition;
+
+      bool m_hasRequest;
+      Request m_request;
+
+      bool m_hasResult;
+      Delta m_result;
+      std::vector<Token> m_resultTokens;
+      // the version the owner has. only changed by takeDelta under the
+      // mutex, the worker reads it under the mutex to compute the delta.
+      std::vector<Token> m_takenTokens;
+    };
+
+  };
+
+};
+
+#endif // __CodeCompletion_KLSemanticTokens__
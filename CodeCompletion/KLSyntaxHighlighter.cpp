@@ -1,6 +1,10 @@
 // Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
 
 #include "KLSyntaxHighlighter.h"
+#include "KLLexer.h"
+
+#include <algorithm>
+#include <limits.h>
 
 using namespace FabricServices;
 using namespace FabricServices::CodeCompletion;
@@ -9,16 +13,48 @@ KLSyntaxHighlighter::KLSyntaxHighlighter(ASTWrapper::KLASTManager * manager)
 : KLASTClient(manager)
 {
   m_enabled = true;
-  m_basicTypesInitialized = false;
-
-  m_knownTokens.insert(std::pair<std::string, Token>("dfgEntry", Token_Keyword));
-  m_knownTokens.insert(std::pair<std::string, Token>("dfgExecute", Token_Keyword));
-  m_knownTokens.insert(std::pair<std::string, Token>("dfgNodePath", Token_Keyword));
-  m_knownTokens.insert(std::pair<std::string, Token>("report", Token_Function));
+  m_useCoreTokenStream = true;
+  m_lastFormatsValid = false;
+  m_registeredTypes = NULL;
+  m_registeredTypeCount = 0;
+
+  m_knownTokens.insert("dfgEntry", Token_Keyword);
+  m_knownTokens.insert("dfgExecute", Token_Keyword);
+  m_knownTokens.insert("dfgNodePath", Token_Keyword);
+  m_knownTokens.insert("report", Token_Function);
+
+  if(manager)
+    setRegisteredTypeTable(manager->getRegisteredTypeTable());
 }
 
 KLSyntaxHighlighter::~KLSyntaxHighlighter()
 {
+  setRegisteredTypeTable(NULL);
+}
+
+bool KLSyntaxHighlighter::setASTManager(ASTWrapper::KLASTManager * manager)
+{
+  if(!ASTWrapper::KLASTClient::setASTManager(manager))
+    return false;
+  setRegisteredTypeTable(manager ? manager->getRegisteredTypeTable() : NULL);
+  return true;
+}
+
+void KLSyntaxHighlighter::setRegisteredTypeTable(ASTWrapper::KLRegisteredTypeTable * table)
+{
+  if(table == m_registeredTypes)
+    return;
+  if(m_registeredTypes)
+    m_registeredTypes->release();
+  m_registeredTypes = table;
+  m_registeredTypeCount = 0;
+  if(m_registeredTypes)
+  {
+    // start querying the core now, the types are
+    // only needed once the first file is parsed
+    m_registeredTypes->retain();
+    m_registeredTypes->updateInBackground();
+  }
 }
 
 bool KLSyntaxHighlighter::isEnabled() const
@@ -31,6 +67,21 @@ void KLSyntaxHighlighter::setEnabled(bool state)
   m_enabled = state;
 }
 
+bool KLSyntaxHighlighter::getUseCoreTokenStream() const
+{
+  return m_useCoreTokenStream;
+}
+
+void KLSyntaxHighlighter::setUseCoreTokenStream(bool state)
+{
+  if(m_useCoreTokenStream == state)
+    return;
+  m_useCoreTokenStream = state;
+  m_lastText = "";
+  m_tokenFormats.clear();
+  m_lastFormatsValid = false;
+}
+
 const char * KLSyntaxHighlighter::getTokenName(Token token)
 {
   switch ( token )
@@ -56,22 +107,172 @@ const std::vector<KLSyntaxHighlighter::Format> & KLSyntaxHighlighter::getHighlig
   if(!m_enabled || !hasASTManager())
   {
     m_lastFormats.clear();
+    m_tokenFormats.clear();
     m_lastText = "";
+    m_lastFormatsValid = false;
     return m_lastFormats;
   }
 
-  if(m_lastText == text)
+  if(m_lastText.length() != text.length() || m_lastText != text)
+  {
+    updateTokenFormats(text);
+    m_lastFormatsValid = false;
+  }
+  if(m_lastFormatsValid)
     return m_lastFormats;
 
+  m_lastFormats = m_tokenFormats;
+  m_lastFormats.insert(m_lastFormats.end(), m_errorFormats.begin(), m_errorFormats.end());
+  m_lastFormats.insert(m_lastFormats.end(), m_highlightFormats.begin(), m_highlightFormats.end());
+  m_lastFormatsValid = true;
+
+  return m_lastFormats;
+}
+
+static bool KLSyntaxHighlighterFormatStartsBefore(const KLSyntaxHighlighter::Format & a, const KLSyntaxHighlighter::Format & b)
+{
+  return a.start < b.start;
+}
+
+static bool KLSyntaxHighlighterFormatEndsBefore(const KLSyntaxHighlighter::Format & a, const KLSyntaxHighlighter::Format & b)
+{
+  return a.start + a.length < b.start + b.length;
+}
+
+static void KLSyntaxHighlighterAppendOverlapping(const std::vector<KLSyntaxHighlighter::Format> & formats, uint32_t startOffset, uint32_t endOffset, std::vector<KLSyntaxHighlighter::Format> & result)
+{
+  for(size_t i=0;i<formats.size();i++)
+  {
+    const KLSyntaxHighlighter::Format & f = formats[i];
+    if(f.start < endOffset && f.start + f.length > startOffset)
+      result.push_back(f);
+  }
+}
+
+const std::vector<KLSyntaxHighlighter::Format> & KLSyntaxHighlighter::getHighlightFormats(const std::string & text, uint32_t startOffset, uint32_t endOffset) const
+{
+  m_rangeFormats.clear();
+  if(!m_enabled || !hasASTManager())
+    return m_rangeFormats;
+
+  if(m_lastText.length() != text.length() || m_lastText != text)
+  {
+    updateTokenFormats(text);
+    m_lastFormatsValid = false;
+  }
+
+  // the token formats don't overlap, so they are sorted by their ends
+  // as well. the first one ending behind the start is the first hit.
+  Format key;
+  key.start = startOffset;
+  key.length = 0;
+  std::vector<Format>::const_iterator it = std::upper_bound(m_tokenFormats.begin(), m_tokenFormats.end(), key, KLSyntaxHighlighterFormatEndsBefore);
+  for(; it != m_tokenFormats.end() && it->start < endOffset; it++)
+    m_rangeFormats.push_back(*it);
+
+  // there are only ever a few overlays, they are filtered in a single pass
+  KLSyntaxHighlighterAppendOverlapping(m_errorFormats, startOffset, endOffset, m_rangeFormats);
+  KLSyntaxHighlighterAppendOverlapping(m_highlightFormats, startOffset, endOffset, m_rangeFormats);
+
+  return m_rangeFormats;
+}
+
+bool KLSyntaxHighlighter::isInsideTokenFormat(uint32_t position) const
+{
+  // the last token starting before the position
+  Format key;
+  key.start = position;
+  std::vector<Format>::const_iterator it = std::lower_bound(m_tokenFormats.begin(), m_tokenFormats.end(), key, KLSyntaxHighlighterFormatStartsBefore);
+  if(it == m_tokenFormats.begin())
+    return false;
+  it--;
+  return it->start + it->length > position;
+}
+
+void KLSyntaxHighlighter::updateTokenFormats(const std::string & text) const
+{
+  uint32_t oldLength = m_lastText.length();
+  uint32_t newLength = text.length();
+
+  if(oldLength == 0 || m_tokenFormats.size() == 0)
+  {
+    uint32_t converged;
+    m_tokenFormats.clear();
+    tokenize(text, 0, UINT_MAX, 0, m_tokenFormats, converged);
+    m_lastText = text;
+    return;
+  }
+
+  // the unchanged head and tail of the text
+  uint32_t maxCommon = oldLength < newLength ? oldLength : newLength;
+  uint32_t prefix = 0;
+  while(prefix < maxCommon && m_lastText[prefix] == text[prefix])
+    prefix++;
+  uint32_t suffix = 0;
+  while(suffix < maxCommon - prefix && m_lastText[oldLength - suffix - 1] == text[newLength - suffix - 1])
+    suffix++;
+
+  // restart at a line start in front of the change which
+  // isn't inside of a multi line token
+  uint32_t start = prefix;
+  for(;;)
+  {
+    while(start > 0 && text[start-1] != '\n')
+      start--;
+    if(start == 0 || !isInsideTokenFormat(start))
+      break;
+    start--;
+  }
+
+  int32_t delta = (int32_t)newLength - (int32_t)oldLength;
   std::vector<Format> formats;
+  uint32_t converged = UINT_MAX;
+  tokenize(text, start, newLength - suffix, delta, formats, converged);
+
+  // keep the old tokens in front of the restart and
+  // behind the point where the tokenizers converged
+  Format key;
+  key.start = start;
+  std::vector<Format>::iterator head = std::lower_bound(m_tokenFormats.begin(), m_tokenFormats.end(), key, KLSyntaxHighlighterFormatStartsBefore);
+  std::vector<Format> tail;
+  if(converged != UINT_MAX)
+  {
+    key.start = converged - delta;
+    std::vector<Format>::iterator it = std::lower_bound(head, m_tokenFormats.end(), key, KLSyntaxHighlighterFormatStartsBefore);
+    for(; it != m_tokenFormats.end(); it++)
+    {
+      Format f = *it;
+      f.start += delta;
+      tail.push_back(f);
+    }
+  }
+
+  m_tokenFormats.erase(head, m_tokenFormats.end());
+  m_tokenFormats.insert(m_tokenFormats.end(), formats.begin(), formats.end());
+  m_tokenFormats.insert(m_tokenFormats.end(), tail.begin(), tail.end());
+  m_lastText = text;
+}
+
+void KLSyntaxHighlighter::tokenize(const std::string & text, uint32_t start, uint32_t convergeAfter, int32_t delta, std::vector<Format> & formats, uint32_t & converged) const
+{
+  converged = UINT_MAX;
+  uint32_t end = 0;
+
+  KLLexer lexer(text.c_str() + start, text.length() - start);
+  FabricCore::KLTokenStream * klTokenStream = NULL;
+  if(m_useCoreTokenStream)
+    klTokenStream = new FabricCore::KLTokenStream(FabricCore::KLTokenStream::Create(*getASTManager()->getClient(), text.c_str() + start, text.length() - start));
 
-  FabricCore::KLTokenStream klTokenStream = FabricCore::KLTokenStream::Create(*getASTManager()->getClient(), text.c_str(), text.length());
   for (;;)
   {
     Format f;
-    f.token = (Token)(int)klTokenStream.getNext( &f.start, &f.length );
+    if(klTokenStream)
+      f.token = (Token)(int)klTokenStream->getNext( &f.start, &f.length );
+    else
+      f.token = lexer.getNext( &f.start, &f.length );
     f.length = f.length - f.start;
-    
+    f.start += start;
+
     if(f.token == (Token)FEC_KLTokenType_EOF)
       break;
 
@@ -96,48 +297,41 @@ const std::vector<KLSyntaxHighlighter::Format> & KLSyntaxHighlighter::getHighlig
       if(text[f.start] == ':') continue;
       if(text[f.start] == ';') continue;
 
-      std::map<std::string, Token>::iterator it = m_knownTokens.find(text.substr(f.start, f.length));
-      if(it == m_knownTokens.end() && f.start == 0)
-        continue;
-      if(it == m_knownTokens.end())
-      {
-        if(text[f.start-1] == '.')
-          f.token = Token_Method;
-        else
-          continue;
-      }
+      int32_t known;
+      if(m_knownTokens.find(text.c_str() + f.start, f.length, known))
+        f.token = (Token)known;
+      else if(f.start > 0 && text[f.start-1] == '.')
+        f.token = Token_Method;
       else
-        f.token = it->second;
+        continue;
     }
 
-    formats.push_back(f);
-  }
-
-  std::map<uint32_t, size_t> sortedIndices;
-  for(size_t i=0;i<formats.size();i++)
-  {
-    std::map<uint32_t, size_t>::iterator it = sortedIndices.find(formats[i].start);
-    if(it == sortedIndices.end())
-      sortedIndices.insert(std::pair<uint32_t, size_t>(formats[i].start, i));
-  }
-
-  m_lastText = text;
-  m_lastFormats.clear();
-  uint32_t end = 0;
-  for(std::map<uint32_t, size_t>::iterator it = sortedIndices.begin(); it != sortedIndices.end(); it++)
-  {
     // ensure to avoid overlapping formats
-    Format f = formats[it->second];
+    if(formats.size() > 0 && f.start <= formats.back().start)
+      continue;
     if(f.start < end)
       continue;
-    m_lastFormats.push_back(f);
+
+    // once a token in the unchanged tail matches a token of the old text
+    // which isn't inside of a multi line token both tokenizers are in the
+    // same state, so everything after it is unchanged.
+    if(f.start > convergeAfter && !isInsideTokenFormat(f.start - delta))
+    {
+      Format key;
+      key.start = f.start - delta;
+      std::vector<Format>::const_iterator it = std::lower_bound(m_tokenFormats.begin(), m_tokenFormats.end(), key, KLSyntaxHighlighterFormatStartsBefore);
+      if(it != m_tokenFormats.end() && it->start == key.start && it->length == f.length && it->token == f.token)
+      {
+        converged = f.start;
+        break;
+      }
+    }
+
+    formats.push_back(f);
     end = f.start + f.length - 1;
   }
 
-  m_lastFormats.insert(m_lastFormats.end(), m_errorFormats.begin(), m_errorFormats.end());
-  m_lastFormats.insert(m_lastFormats.end(), m_highlightFormats.begin(), m_highlightFormats.end());
-
-  return m_lastFormats;
+  delete(klTokenStream);
 }
 
 std::string KLSyntaxHighlighter::getHighlightedText(const std::string & text) const
@@ -171,13 +365,13 @@ void KLSyntaxHighlighter::reportError(uint32_t start, uint32_t length)
   f.start = start;
   f.length = length;
   m_errorFormats.push_back(f);
-  m_lastText = "";
+  m_lastFormatsValid = false;
 }
 
 void KLSyntaxHighlighter::clearErrors()
 {
   m_errorFormats.clear();
-  m_lastText = "";
+  m_lastFormatsValid = false;
 }
 
 void KLSyntaxHighlighter::highlight(uint32_t start, uint32_t length)
@@ -187,39 +381,26 @@ void KLSyntaxHighlighter::highlight(uint32_t start, uint32_t length)
   f.start = start;
   f.length = length;
   m_highlightFormats.push_back(f);
-  m_lastText = "";
+  m_lastFormatsValid = false;
 }
 
 void KLSyntaxHighlighter::clearHighlighting()
 {
   m_highlightFormats.clear();
-  m_lastText = "";
+  m_lastFormatsValid = false;
 }
 
 void KLSyntaxHighlighter::onFileParsed(const ASTWrapper::KLFile * file)
 {
-  if(!m_basicTypesInitialized)
+  bool addedTokens = false;
+  if(m_registeredTypes)
   {
-    // ask the ast manager for all basic types
-    const FabricCore::Client * client = getASTManager()->getClient();
-    FabricCore::Variant registeredTypes = FabricCore::GetRegisteredTypes_Variant(*client);
-    for(FabricCore::Variant::DictIter keyIter(registeredTypes); !keyIter.isDone(); keyIter.next())
-    {
-      std::string key = keyIter.getKey()->getStringData();
-      if(key.substr(key.length()-1, 1) == ">")
-        continue;
-      if(GetRegisteredTypeIsStruct(*client, key.c_str()))
-        continue;
-      if(GetRegisteredTypeIsObject(*client, key.c_str()))
-        continue;
-      if(GetRegisteredTypeIsInterface(*client, key.c_str()))
-        continue;
-      if(m_knownTokens.find(key) != m_knownTokens.end())
-        continue;
-      m_knownTokens.insert(std::pair<std::string, Token>(key, Token_Type));
-    }
-
-    m_basicTypesInitialized = true;
+    // only the types registered since the last file was parsed
+    std::vector<std::string> typeNames;
+    m_registeredTypeCount = m_registeredTypes->getTypeNames(m_registeredTypeCount, typeNames);
+    for(size_t i=0;i<typeNames.size();i++)
+      if(m_knownTokens.insert(typeNames[i], Token_Type))
+        addedTokens = true;
   }
 
   std::vector<const ASTWrapper::KLConstant*> constants = file->getConstants();
@@ -229,31 +410,35 @@ void KLSyntaxHighlighter::onFileParsed(const ASTWrapper::KLFile * file)
 
   for(size_t i=0;i<constants.size();i++)
   {
-    if(m_knownTokens.find(constants[i]->getName()) != m_knownTokens.end())
-      continue;
-    m_knownTokens.insert(std::pair<std::string, Token>(constants[i]->getName(), Token_Constant));
+    if(m_knownTokens.insert(constants[i]->getName(), Token_Constant))
+      addedTokens = true;
   }
 
   for(size_t i=0;i<types.size();i++)
   {
-    if(m_knownTokens.find(types[i]->getName()) != m_knownTokens.end())
-      continue;
-    m_knownTokens.insert(std::pair<std::string, Token>(types[i]->getName(), Token_Type));
+    if(m_knownTokens.insert(types[i]->getName(), Token_Type))
+      addedTokens = true;
   }
 
   for(size_t i=0;i<aliases.size();i++)
   {
-    if(m_knownTokens.find(aliases[i]->getNewUserName()) != m_knownTokens.end())
-      continue;
-    m_knownTokens.insert(std::pair<std::string, Token>(aliases[i]->getNewUserName(), Token_Type));
+    if(m_knownTokens.insert(aliases[i]->getNewUserName(), Token_Type))
+      addedTokens = true;
   }
 
   for(size_t i=0;i<functions.size();i++)
   {
     if(functions[i]->getName().length() <= 2)
       continue;
-    if(m_knownTokens.find(functions[i]->getName()) != m_knownTokens.end())
-      continue;
-    m_knownTokens.insert(std::pair<std::string, Token>(functions[i]->getName(), Token_Function));
+    if(m_knownTokens.insert(functions[i]->getName(), Token_Function))
+      addedTokens = true;
+  }
+
+  // the cached formats were tokenized without the new names
+  if(addedTokens)
+  {
+    m_tokenFormats.clear();
+    m_lastText = "";
+    m_lastFormatsValid = false;
   }
 }
@@ -12,6 +12,8 @@
 #include <ASTWrapper/KLASTClient.h>
 #include <ASTWrapper/KLFile.h>
 
+#include "KLTokenTable.h"
+
 namespace FabricServices
 {
 
@@ -50,13 +52,27 @@ namespace FabricServices
       KLSyntaxHighlighter(ASTWrapper::KLASTManager * manager);
       virtual ~KLSyntaxHighlighter();
 
+      virtual bool setASTManager(ASTWrapper::KLASTManager * manager);
+
       bool isEnabled() const;
       void setEnabled(bool state);
 
       static const char * getTokenName(Token token);
 
+      // the text is tokenized by FabricCore::KLTokenStream by default.
+      // disabling this opts into the native KLLexer, which avoids the
+      // round trip through the core but isn't verified to produce the
+      // same tokens yet, see CodeCompletion/Tools/KLTokenParity.cpp.
+      // the KLSemanticTokens of a KLCodeAssistant follow this setting.
+      bool getUseCoreTokenStream() const;
+      void setUseCoreTokenStream(bool state);
+
       // highlighting
       virtual const std::vector<Format> & getHighlightFormats(const std::string & text) const;
+      // only the formats overlapping [startOffset, endOffset), for example
+      // the visible lines of an editor. the token formats come first,
+      // followed by the error and highlight formats, as above.
+      virtual const std::vector<Format> & getHighlightFormats(const std::string & text, uint32_t startOffset, uint32_t endOffset) const;
       virtual std::string getHighlightedText(const std::string & text) const;
 
       // error reporting
@@ -71,13 +87,32 @@ namespace FabricServices
 
     private:
 
-      bool m_basicTypesInitialized;
+      // re-tokenizes the text, starting at the line of the first change
+      // and stopping as soon as the tokenizer is back in step with the
+      // previous tokens in the unchanged tail of the text.
+      void updateTokenFormats(const std::string & text) const;
+      void tokenize(const std::string & text, uint32_t start, uint32_t convergeAfter, int32_t delta, std::vector<Format> & formats, uint32_t & converged) const;
+      bool isInsideTokenFormat(uint32_t position) const;
+      void setRegisteredTypeTable(ASTWrapper::KLRegisteredTypeTable * table);
+
+      // the basic types shared through the manager, and how
+      // many of them have been added to the known tokens
+      ASTWrapper::KLRegisteredTypeTable * m_registeredTypes;
+      uint32_t m_registeredTypeCount;
       bool m_enabled;
+      bool m_useCoreTokenStream;
+      // the text tokenized last and its tokens, sorted by start. a line
+      // start covered by a token (a multi line comment) carries state,
+      // every other line start is a clean point to restart from.
       mutable std::string m_lastText;
+      mutable std::vector<Format> m_tokenFormats;
+      // the token formats followed by the error and highlight formats
       mutable std::vector<Format> m_lastFormats;
+      mutable bool m_lastFormatsValid;
+      mutable std::vector<Format> m_rangeFormats;
       mutable std::vector<Format> m_errorFormats;
       mutable std::vector<Format> m_highlightFormats;
-      mutable std::map<std::string, Token> m_knownTokens;
+      KLTokenTable m_knownTokens;
     };
 
   };
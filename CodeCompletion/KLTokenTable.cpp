@@ -0,0 +1,110 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "KLTokenTable.h"
+
+#include <string.h>
+
+using namespace FabricServices::CodeCompletion;
+
+#define KLTOKENTABLE_INITIAL_SLOTS 1024
+
+KLTokenTable::KLTokenTable()
+{
+  Slot empty;
+  empty.hash = 0;
+  empty.value = 0;
+  empty.nameIndex = 0;
+  m_slots.resize(KLTOKENTABLE_INITIAL_SLOTS, empty);
+}
+
+uint32_t KLTokenTable::getCount() const
+{
+  return (uint32_t)m_names.size();
+}
+
+uint32_t KLTokenTable::hashName(const char * name, uint32_t length)
+{
+  // FNV-1a, never 0 so that 0 can mark empty slots
+  uint32_t hash = 2166136261u;
+  for(uint32_t i=0;i<length;i++)
+  {
+    hash ^= (uint8_t)name[i];
+    hash *= 16777619u;
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+int32_t KLTokenTable::findSlot(const char * name, uint32_t length, uint32_t hash) const
+{
+  // linear probing, the table is never more than half full
+  uint32_t mask = (uint32_t)m_slots.size() - 1;
+  for(uint32_t index = hash & mask;; index = (index + 1) & mask)
+  {
+    const Slot & slot = m_slots[index];
+    if(slot.hash == 0)
+      return -1 - (int32_t)index;
+    if(slot.hash != hash)
+      continue;
+    const std::string & slotName = m_names[slot.nameIndex];
+    if(slotName.length() == length && memcmp(slotName.c_str(), name, length) == 0)
+      return (int32_t)index;
+  }
+}
+
+void KLTokenTable::grow()
+{
+  std::vector<Slot> slots;
+  slots.swap(m_slots);
+
+  Slot empty;
+  empty.hash = 0;
+  empty.value = 0;
+  empty.nameIndex = 0;
+  m_slots.resize(slots.size() * 2, empty);
+
+  uint32_t mask = (uint32_t)m_slots.size() - 1;
+  for(size_t i=0;i<slots.size();i++)
+  {
+    if(slots[i].hash == 0)
+      continue;
+    uint32_t index = slots[i].hash & mask;
+    while(m_slots[index].hash != 0)
+      index = (index + 1) & mask;
+    m_slots[index] = slots[i];
+  }
+}
+
+bool KLTokenTable::insert(const std::string & name, int32_t value)
+{
+  uint32_t hash = hashName(name.c_str(), (uint32_t)name.length());
+  int32_t index = findSlot(name.c_str(), (uint32_t)name.length(), hash);
+  if(index >= 0)
+    return false;
+
+  if((m_names.size() + 1) * 2 > m_slots.size())
+  {
+    grow();
+    index = findSlot(name.c_str(), (uint32_t)name.length(), hash);
+  }
+
+  Slot & slot = m_slots[-1 - index];
+  slot.hash = hash;
+  slot.value = value;
+  slot.nameIndex = (uint32_t)m_names.size();
+  m_names.push_back(name);
+  return true;
+}
+
+bool KLTokenTable::contains(const char * name, uint32_t length) const
+{
+  return findSlot(name, length, hashName(name, length)) >= 0;
+}
+
+bool KLTokenTable::find(const char * name, uint32_t length, int32_t & value) const
+{
+  int32_t index = findSlot(name, length, hashName(name, length));
+  if(index < 0)
+    return false;
+  value = m_slots[index].value;
+  return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __CodeCompletion_KLTokenTable__
+#define __CodeCompletion_KLTokenTable__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace FabricServices
+{
+
+  namespace CodeCompletion
+  {
+
+    // An open addressing hash table mapping names to token classes. The
+    // lookup takes a pointer and length into the text being highlighted,
+    // so classifying a token doesn't allocate. Names are only ever added,
+    // the first value inserted for a name wins.
+    class KLTokenTable
+    {
+    public:
+
+      KLTokenTable();
+
+      uint32_t getCount() const;
+
+      // returns false if the name is known already
+      bool insert(const std::string & name, int32_t value);
+      bool contains(const char * name, uint32_t length) const;
+      bool find(const char * name, uint32_t length, int32_t & value) const;
+
+    private:
+
+      struct Slot
+      {
+        // 0 marks an empty slot
+        uint32_t hash;
+        int32_t value;
+        uint32_t nameIndex;
+      };
+
+      static uint32_t hashName(const char * name, uint32_t length);
+      int32_t findSlot(const char * name, uint32_t length, uint32_t hash) const;
+      void grow();
+
+      std::vector<Slot> m_slots;
+      std::vector<std::string> m_names;
+    };
+
+  };
+
+};
+
+#endif // __CodeCompletion_KLTokenTable__
@@ -0,0 +1,164 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+// Tokenizes all KL files below FABRIC_EXTS_PATH with both the KLLexer
+// and FabricCore::KLTokenStream and reports where they disagree. The
+// KLSyntaxHighlighter only uses the KLLexer on request until this
+// reports no differences.
+
+#include <CodeCompletion/KLLexer.h>
+#include <ASTWrapper/KLSourceFile.h>
+
+#include <FTL/Env.h>
+#include <FTL/FS.h>
+#include <FTL/Path.h>
+
+#include <string.h>
+#include <stdio.h>
+
+using namespace FabricServices;
+using namespace FabricServices::CodeCompletion;
+
+struct KLTokenParityToken
+{
+  int32_t token;
+  uint32_t start;
+  uint32_t end;
+
+  bool operator != (const KLTokenParityToken & other) const
+  {
+    return token != other.token || start != other.start || end != other.end;
+  }
+};
+
+static void collectKLFiles(const std::string & folder, std::vector<std::string> & files)
+{
+  std::vector<std::string> dirEntries;
+  if ( !FTL::FSDirAppendEntries( folder, dirEntries ) )
+    return;
+
+  for ( std::vector<std::string>::const_iterator it = dirEntries.begin();
+    it != dirEntries.end(); ++it )
+  {
+    std::string const &entry = *it;
+    if ( entry == "." || entry == ".." )
+      continue;
+    std::string entryPath = FTL::PathJoin( folder, entry );
+    FTL::FSStatInfo entryStatInfo;
+    if ( !FTL::FSStat( entryPath, entryStatInfo ) )
+      continue;
+    if ( entryStatInfo.type == FTL::FSStatInfo::Dir )
+      collectKLFiles( entryPath, files );
+    else if ( entryStatInfo.type == FTL::FSStatInfo::File
+      && entry.length() > 3 && entry.substr(entry.length()-3, 3) == ".kl" )
+      files.push_back( entryPath );
+  }
+}
+
+static void tokenizeWithLexer(const std::string & code, std::vector<KLTokenParityToken> & tokens)
+{
+  KLLexer lexer(code.c_str(), code.length());
+  for(;;)
+  {
+    KLTokenParityToken t;
+    t.token = (int32_t)lexer.getNext(&t.start, &t.end);
+    if(t.token == (int32_t)KLSyntaxHighlighter::Token_EOF)
+      break;
+    tokens.push_back(t);
+  }
+}
+
+static void tokenizeWithCore(const FabricCore::Client & client, const std::string & code, std::vector<KLTokenParityToken> & tokens)
+{
+  FabricCore::KLTokenStream klTokenStream = FabricCore::KLTokenStream::Create(client, code.c_str(), code.length());
+  for(;;)
+  {
+    KLTokenParityToken t;
+    t.token = (int32_t)klTokenStream.getNext(&t.start, &t.end);
+    if(t.token == (int32_t)FEC_KLTokenType_EOF)
+      break;
+    tokens.push_back(t);
+  }
+}
+
+static void printToken(const char * label, const std::string & code, const std::vector<KLTokenParityToken> & tokens, size_t index)
+{
+  if(index >= tokens.size())
+  {
+    printf("  %s: <end of tokens>\n", label);
+    return;
+  }
+
+  const KLTokenParityToken & t = tokens[index];
+  std::string text = code.substr(t.start, t.end - t.start);
+  if(text.length() > 40)
+    text = text.substr(0, 40) + "...";
+  for(size_t i=0;i<text.length();i++)
+  {
+    if(text[i] == '\n' || text[i] == '\r' || text[i] == '\t')
+      text[i] = ' ';
+  }
+  printf("  %s: %s [%u, %u) '%s'\n", label,
+    KLSyntaxHighlighter::getTokenName((KLSyntaxHighlighter::Token)t.token),
+    t.start, t.end, text.c_str());
+}
+
+int main(int argc, char ** argv)
+{
+  std::vector<std::string> folders;
+  if ( !FTL::EnvGetList( "FABRIC_EXTS_PATH", folders ) )
+  {
+    printf("FABRIC_EXTS_PATH is not set.\n");
+    return 1;
+  }
+
+  std::vector<std::string> files;
+  for(size_t i=0;i<folders.size();i++)
+    collectKLFiles(folders[i], files);
+
+  try
+  {
+    FabricCore::Client::CreateOptions options;
+    memset( &options, 0, sizeof( options ) );
+    options.guarded = 1;
+    FabricCore::Client client(NULL, NULL, &options);
+
+    uint32_t numMismatches = 0;
+    for(size_t i=0;i<files.size();i++)
+    {
+      std::string code;
+      if(!ASTWrapper::KLSourceFile::read(files[i].c_str(), code))
+      {
+        printf("Cannot read '%s'.\n", files[i].c_str());
+        continue;
+      }
+
+      std::vector<KLTokenParityToken> lexerTokens;
+      std::vector<KLTokenParityToken> coreTokens;
+      tokenizeWithLexer(code, lexerTokens);
+      tokenizeWithCore(client, code, coreTokens);
+
+      // only the first difference of a file is reported, the
+      // tokens after it are usually shifted as well
+      size_t count = lexerTokens.size() > coreTokens.size() ? lexerTokens.size() : coreTokens.size();
+      for(size_t j=0;j<count;j++)
+      {
+        if(j < lexerTokens.size() && j < coreTokens.size() && !(lexerTokens[j] != coreTokens[j]))
+          continue;
+
+        printf("%s: token %u differs\n", files[i].c_str(), (uint32_t)j);
+        printToken("KLLexer      ", code, lexerTokens, j);
+        printToken("KLTokenStream", code, coreTokens, j);
+        numMismatches++;
+        break;
+      }
+    }
+
+    printf("%u of %u files differ.\n", numMismatches, (uint32_t)files.size());
+    return numMismatches == 0 ? 0 : 1;
+  }
+  catch(FabricCore::Exception e)
+  {
+    printf("FabricCore::Exception: %s\n", e.getDesc_cstr());
+    return 1;
+  }
+}
@@ -2,6 +2,8 @@
 
 #include "Command.h"
 
+#include <string.h>
+
 using namespace FabricServices::Commands;
 
 unsigned int Command::s_maxID = 1;
@@ -9,6 +11,10 @@ unsigned int Command::s_maxID = 1;
 Command::Command()
 {
   m_id = s_maxID++;
+  m_stackMemoryUsage = 0;
+  m_spilled = false;
+  m_spillOffset = 0;
+  m_spillLength = 0;
 }
 
 Command::~Command()
@@ -21,11 +27,44 @@ unsigned int Command::getID() const
   return m_id;
 }
 
+uint64_t Command::getMemoryUsage() const
+{
+  return 0;
+}
+
+std::string Command::getMergeKey() const
+{
+  return std::string();
+}
+
+bool Command::canMergeWith(const Command * other) const
+{
+  if(strcmp(getName(), other->getName()) != 0)
+    return false;
+  std::string key = getMergeKey();
+  return key.length() > 0 && key == other->getMergeKey();
+}
+
 void Command::destroy()
 {
 
 }
 
+bool Command::spill(std::string & data)
+{
+  return false;
+}
+
+bool Command::restore(const std::string & data)
+{
+  return false;
+}
+
+bool Command::mergeWith(Command * other)
+{
+  return false;
+}
+
 bool Command::redo()
 {
   return invoke();
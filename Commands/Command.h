@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 namespace FabricServices
 {
@@ -14,6 +15,7 @@ namespace FabricServices
     class Command
     {
       friend class CommandStack;
+      friend class CommandQueue;
       friend class CompoundCommand;
 
     public:
@@ -26,6 +28,18 @@ namespace FabricServices
       virtual const char * getShortDesc() const = 0;
       virtual const char * getFullDesc() const = 0;
 
+      // the approximate number of bytes held by the command, used by
+      // the CommandStack's memory budget. commands holding snapshots
+      // or other large data should report them here.
+      virtual uint64_t getMemoryUsage() const;
+
+      // identifies what the command changes, for example the parameter
+      // a slider drives. commands of the same name and merge key added
+      // in quick succession are merged by the CommandStack. commands
+      // with an empty key (the default) are never merged.
+      virtual std::string getMergeKey() const;
+      virtual bool canMergeWith(const Command * other) const;
+
     protected:
       
       virtual bool invoke() = 0;
@@ -33,10 +47,29 @@ namespace FabricServices
       virtual bool redo();
       virtual void destroy(); 
 
+      // commands which can give up their memory while waiting on the
+      // undo stack write their state to data and release it in spill,
+      // and get it back in restore before they are undone. commands
+      // which can't be spilled are dropped from the history instead.
+      virtual bool spill(std::string & data);
+      virtual bool restore(const std::string & data);
+
+      // takes over the end state of the newer, already invoked command,
+      // so that undoing this command undoes both. the other command is
+      // deleted afterwards without being destroyed.
+      virtual bool mergeWith(Command * other);
+
     private:
 
       unsigned int m_id;
       static unsigned int s_maxID;
+
+      // bookkeeping of the CommandStack: the memory usage accounted
+      // for the command and where its state is in the spill file
+      uint64_t m_stackMemoryUsage;
+      bool m_spilled;
+      uint64_t m_spillOffset;
+      uint32_t m_spillLength;
     };
 
     typedef std::vector<Command*> CommandVector;
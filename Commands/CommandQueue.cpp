@@ -0,0 +1,164 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "CommandQueue.h"
+
+#include <cstddef>
+
+using namespace FabricServices::Commands;
+using namespace FabricServices::Threading;
+
+CommandFuture::CommandFuture(unsigned int commandID)
+{
+  m_commandID = commandID;
+  m_refs = 1;
+  m_state = State_Queued;
+}
+
+CommandFuture::~CommandFuture()
+{
+}
+
+void CommandFuture::retain()
+{
+  MutexLocker locker(m_mutex);
+  m_refs++;
+}
+
+void CommandFuture::release()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_refs--;
+    if(m_refs > 0)
+      return;
+  }
+  delete(this);
+}
+
+unsigned int CommandFuture::getCommandID() const
+{
+  return m_commandID;
+}
+
+CommandFuture::State CommandFuture::getState()
+{
+  MutexLocker locker(m_mutex);
+  return m_state;
+}
+
+bool CommandFuture::isDone()
+{
+  return getState() != State_Queued;
+}
+
+bool CommandFuture::wait()
+{
+  MutexLocker locker(m_mutex);
+  while(m_state == State_Queued)
+    m_condition.wait(m_mutex);
+  return m_state == State_Succeeded;
+}
+
+void CommandFuture::complete(bool succeeded)
+{
+  MutexLocker locker(m_mutex);
+  m_state = succeeded ? State_Succeeded : State_Failed;
+  m_condition.wakeAll();
+}
+
+CommandQueue::CommandQueue()
+{
+  m_stop = false;
+  m_busy = false;
+}
+
+CommandQueue::~CommandQueue()
+{
+  wait();
+  stop();
+}
+
+CommandFuture * CommandQueue::enqueue(Command * command, Callback callback, void * userData)
+{
+  Item item;
+  item.command = command;
+  item.callback = callback;
+  item.userData = userData;
+  item.future = new CommandFuture(command->getID());
+  // one reference for the caller, one for the queue
+  item.future->retain();
+
+  {
+    MutexLocker locker(m_mutex);
+    m_items.push_back(item);
+    m_condition.wakeAll();
+  }
+
+  if(!isRunning())
+    start();
+  return item.future;
+}
+
+void CommandQueue::wait()
+{
+  MutexLocker locker(m_mutex);
+  while(m_items.size() > 0 || m_busy)
+    m_condition.wait(m_mutex);
+}
+
+bool CommandQueue::takeInvoked(Command *& command, bool & succeeded)
+{
+  MutexLocker locker(m_mutex);
+  if(m_invoked.size() == 0)
+    return false;
+  command = m_invoked.front().command;
+  succeeded = m_invoked.front().succeeded;
+  m_invoked.pop_front();
+  return true;
+}
+
+void CommandQueue::stop()
+{
+  {
+    MutexLocker locker(m_mutex);
+    m_stop = true;
+    m_condition.wakeAll();
+  }
+  join();
+
+  MutexLocker locker(m_mutex);
+  m_stop = false;
+}
+
+void CommandQueue::run()
+{
+  m_mutex.lock();
+  for(;;)
+  {
+    while(!m_stop && m_items.size() == 0)
+      m_condition.wait(m_mutex);
+    if(m_items.size() == 0)
+      break;
+
+    Item item = m_items.front();
+    m_items.pop_front();
+    m_busy = true;
+    m_mutex.unlock();
+
+    bool succeeded = item.command->invoke();
+    if(item.callback)
+      (*item.callback)(item.command, succeeded, item.userData);
+
+    m_mutex.lock();
+    Invoked invoked;
+    invoked.command = item.command;
+    invoked.succeeded = succeeded;
+    m_invoked.push_back(invoked);
+    m_busy = false;
+    m_condition.wakeAll();
+
+    item.future->complete(succeeded);
+    item.future->release();
+  }
+  m_mutex.unlock();
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __Commands_CommandQueue__
+#define __Commands_CommandQueue__
+
+#include "Command.h"
+#include <Threading/Thread.h>
+
+#include <deque>
+
+namespace FabricServices
+{
+
+  namespace Commands
+  {
+    // The outcome of a queued command. Futures are reference counted,
+    // the caller receiving one from the queue has to release it.
+    class CommandFuture
+    {
+      friend class CommandQueue;
+      friend class CommandStack;
+
+    public:
+
+      enum State
+      {
+        State_Queued,
+        State_Succeeded,
+        State_Failed
+      };
+
+      void retain();
+      void release();
+
+      unsigned int getCommandID() const;
+      State getState();
+      bool isDone();
+      // blocks until the command has been invoked,
+      // returns true if the invocation succeeded
+      bool wait();
+
+    private:
+
+      CommandFuture(unsigned int commandID);
+      ~CommandFuture();
+
+      CommandFuture(const CommandFuture & other);
+      CommandFuture & operator = (const CommandFuture & other);
+
+      void complete(bool succeeded);
+
+      unsigned int m_commandID;
+      uint32_t m_refs;
+      State m_state;
+      Threading::Mutex m_mutex;
+      Threading::Condition m_condition;
+    };
+
+    // Invokes commands in the order they were queued on a worker thread.
+    // The queue doesn't touch the commands once they have been invoked,
+    // the owner picks them up in order through takeInvoked. The callback
+    // runs on the worker thread right after a command has been invoked.
+    class CommandQueue : public Threading::Thread
+    {
+    public:
+
+      typedef void (*Callback)(Command * command, bool succeeded, void * userData);
+
+      CommandQueue();
+      virtual ~CommandQueue();
+
+      // the returned future has to be released by the caller
+      CommandFuture * enqueue(Command * command, Callback callback = 0, void * userData = 0);
+
+      // blocks until all queued commands have been invoked
+      void wait();
+      // returns false if no invoked command is waiting to be taken
+      bool takeInvoked(Command *& command, bool & succeeded);
+
+    protected:
+
+      virtual void run();
+
+    private:
+
+      struct Item
+      {
+        Command * command;
+        Callback callback;
+        void * userData;
+        CommandFuture * future;
+      };
+
+      struct Invoked
+      {
+        Command * command;
+        bool succeeded;
+      };
+
+      void stop();
+
+      Threading::Mutex m_mutex;
+      Threading::Condition m_condition;
+      bool m_stop;
+      bool m_busy;
+      std::deque<Item> m_items;
+      std::deque<Invoked> m_invoked;
+    };
+
+  };
+
+};
+
+#endif // __Commands_CommandQueue__
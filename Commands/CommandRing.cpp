@@ -0,0 +1,99 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "CommandRing.h"
+
+#include <cstddef>
+
+using namespace FabricServices::Commands;
+
+CommandRing::CommandRing()
+{
+  m_buffer = NULL;
+  m_capacity = 0;
+  m_first = 0;
+  m_count = 0;
+}
+
+CommandRing::~CommandRing()
+{
+  delete [] m_buffer;
+}
+
+uint32_t CommandRing::getCount() const
+{
+  return m_count;
+}
+
+bool CommandRing::isEmpty() const
+{
+  return m_count == 0;
+}
+
+Command * CommandRing::get(uint32_t index) const
+{
+  if(index >= m_count)
+    return NULL;
+  return m_buffer[(m_first + index) % m_capacity];
+}
+
+Command * CommandRing::front() const
+{
+  return get(0);
+}
+
+Command * CommandRing::back() const
+{
+  if(m_count == 0)
+    return NULL;
+  return get(m_count - 1);
+}
+
+void CommandRing::pushBack(Command * command)
+{
+  if(m_count == m_capacity)
+    setCapacity(m_capacity == 0 ? 16 : m_capacity * 2);
+  m_buffer[(m_first + m_count) % m_capacity] = command;
+  m_count++;
+}
+
+Command * CommandRing::popFront()
+{
+  if(m_count == 0)
+    return NULL;
+  Command * command = m_buffer[m_first];
+  m_first = (m_first + 1) % m_capacity;
+  m_count--;
+  return command;
+}
+
+Command * CommandRing::popBack()
+{
+  if(m_count == 0)
+    return NULL;
+  Command * command = back();
+  m_count--;
+  return command;
+}
+
+void CommandRing::clear()
+{
+  m_first = 0;
+  m_count = 0;
+}
+
+void CommandRing::setCapacity(uint32_t capacity)
+{
+  if(capacity < m_count)
+    capacity = m_count;
+  if(capacity == m_capacity)
+    return;
+
+  Command ** buffer = capacity > 0 ? new Command*[capacity] : NULL;
+  for(uint32_t i=0;i<m_count;i++)
+    buffer[i] = get(i);
+
+  delete [] m_buffer;
+  m_buffer = buffer;
+  m_capacity = capacity;
+  m_first = 0;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __Commands_CommandRing__
+#define __Commands_CommandRing__
+
+#include "Command.h"
+
+#include <stdint.h>
+
+namespace FabricServices
+{
+
+  namespace Commands
+  {
+    // A ring buffer of commands, used by the CommandStack for its undo
+    // and redo stacks. Commands can be added and removed at both ends in
+    // constant time, so dropping the oldest command once the stack is at
+    // its limit doesn't move the others. The ring doesn't own the
+    // commands, removed commands are handed back to the caller.
+    class CommandRing
+    {
+    public:
+
+      CommandRing();
+      ~CommandRing();
+
+      uint32_t getCount() const;
+      bool isEmpty() const;
+
+      // index 0 is the oldest command
+      Command * get(uint32_t index) const;
+      Command * front() const;
+      Command * back() const;
+
+      // grows the buffer if it is full
+      void pushBack(Command * command);
+      Command * popFront();
+      Command * popBack();
+      void clear();
+
+      // reallocates the buffer to hold at least this many commands,
+      // a stack with a limit sets it once and never grows after that.
+      void setCapacity(uint32_t capacity);
+
+    private:
+
+      // non copyable
+      CommandRing(const CommandRing & other);
+      CommandRing & operator = (const CommandRing & other);
+
+      Command ** m_buffer;
+      uint32_t m_capacity;
+      uint32_t m_first;
+      uint32_t m_count;
+    };
+
+  };
+
+};
+
+#endif // __Commands_CommandRing__
@@ -0,0 +1,208 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "CommandSpillFile.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#if defined(_WIN32)
+# include <windows.h>
+# include <io.h>
+# include <fcntl.h>
+#else
+# include <unistd.h>
+#endif
+
+using namespace FabricServices::Commands;
+
+CommandSpillFile::CommandSpillFile()
+{
+  m_file = NULL;
+  m_size = 0;
+  m_records = 0;
+}
+
+CommandSpillFile::~CommandSpillFile()
+{
+  close();
+}
+
+bool CommandSpillFile::write(const std::string & data, uint64_t & offset)
+{
+  if(m_file == NULL && !open())
+    return false;
+
+  // the first released range large enough, otherwise the end
+  uint64_t length = data.length();
+  std::map<uint64_t, uint64_t>::iterator it = m_freeRanges.begin();
+  if(length > 0)
+  {
+    for(;it != m_freeRanges.end();it++)
+    {
+      if(it->second >= length)
+        break;
+    }
+  }
+  else
+    it = m_freeRanges.end();
+
+  offset = it != m_freeRanges.end() ? it->first : m_size;
+  if(!seek(offset) || (length > 0 && fwrite(data.c_str(), 1, length, m_file) != length))
+  {
+    m_error = "Cannot write to the temporary file.";
+    return false;
+  }
+
+  if(it != m_freeRanges.end())
+  {
+    uint64_t remaining = it->second - length;
+    m_freeRanges.erase(it);
+    if(remaining > 0)
+      m_freeRanges[offset + length] = remaining;
+  }
+  else
+    m_size += length;
+  m_records++;
+  return true;
+}
+
+bool CommandSpillFile::read(uint64_t offset, uint32_t length, std::string & data)
+{
+  data.resize(length);
+  if(length == 0)
+    return true;
+  if(m_file == NULL || !seek(offset))
+    return false;
+  return fread(&data[0], 1, length, m_file) == length;
+}
+
+void CommandSpillFile::release(uint64_t offset, uint32_t length)
+{
+  if(m_records == 0)
+    return;
+  m_records--;
+  if(m_records == 0)
+  {
+    close();
+    return;
+  }
+  if(length == 0)
+    return;
+
+  // merge the range with the free ranges next to it
+  uint64_t end = offset + length;
+  std::map<uint64_t, uint64_t>::iterator next = m_freeRanges.lower_bound(offset);
+  if(next != m_freeRanges.end() && next->first == end)
+  {
+    end += next->second;
+    m_freeRanges.erase(next++);
+  }
+  if(next != m_freeRanges.begin())
+  {
+    std::map<uint64_t, uint64_t>::iterator previous = next;
+    previous--;
+    if(previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      m_freeRanges.erase(previous);
+    }
+  }
+
+  // a free range at the end is appended to again
+  if(end == m_size)
+    m_size = offset;
+  else
+    m_freeRanges[offset] = end - offset;
+}
+
+const std::string & CommandSpillFile::getError() const
+{
+  return m_error;
+}
+
+bool CommandSpillFile::open()
+{
+  // tmpfile creates its files in the root of the drive with the
+  // MSVC runtime, which usually isn't writable, so the file is
+  // created explicitly in the temporary folder of the user.
+#if defined(_WIN32)
+  char folder[MAX_PATH+1];
+  char filePath[MAX_PATH+1];
+  DWORD folderLength = GetTempPathA(MAX_PATH+1, folder);
+  if(folderLength == 0 || folderLength > MAX_PATH || GetTempFileNameA(folder, "fcs", 0, filePath) == 0)
+  {
+    m_error = "Cannot determine a temporary file name.";
+    return false;
+  }
+
+  HANDLE handle = CreateFileA(filePath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+    FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if(handle == INVALID_HANDLE_VALUE)
+  {
+    DeleteFileA(filePath);
+    m_error = std::string("Cannot create the temporary file '") + filePath + "'.";
+    return false;
+  }
+  int fd = _open_osfhandle((intptr_t)handle, _O_RDWR | _O_BINARY);
+  if(fd == -1)
+  {
+    CloseHandle(handle);
+    m_error = std::string("Cannot open the temporary file '") + filePath + "'.";
+    return false;
+  }
+  m_file = _fdopen(fd, "w+b");
+  if(m_file == NULL)
+  {
+    _close(fd);
+    m_error = std::string("Cannot open the temporary file '") + filePath + "'.";
+    return false;
+  }
+#else
+  const char * folder = getenv("TMPDIR");
+  if(folder == NULL || folder[0] == '\0')
+    folder = "/tmp";
+  std::string pattern = folder;
+  pattern += "/FabricCommands.XXXXXX";
+  std::vector<char> filePath(pattern.begin(), pattern.end());
+  filePath.push_back('\0');
+
+  int fd = mkstemp(&filePath[0]);
+  if(fd == -1)
+  {
+    m_error = "Cannot create a temporary file in '" + std::string(folder) + "'.";
+    return false;
+  }
+  // the file stays accessible through the descriptor
+  unlink(&filePath[0]);
+  m_file = fdopen(fd, "w+b");
+  if(m_file == NULL)
+  {
+    ::close(fd);
+    m_error = std::string("Cannot open the temporary file '") + &filePath[0] + "'.";
+    return false;
+  }
+#endif
+
+  m_size = 0;
+  m_error.clear();
+  return true;
+}
+
+bool CommandSpillFile::seek(uint64_t offset)
+{
+#if defined(_WIN32)
+  return _fseeki64(m_file, (__int64)offset, SEEK_SET) == 0;
+#else
+  return fseeko(m_file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+void CommandSpillFile::close()
+{
+  if(m_file)
+    fclose(m_file);
+  m_file = NULL;
+  m_size = 0;
+  m_records = 0;
+  m_freeRanges.clear();
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __Commands_CommandSpillFile__
+#define __Commands_CommandSpillFile__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <map>
+
+namespace FabricServices
+{
+
+  namespace Commands
+  {
+    // An anonymous temporary file holding the state of commands spilled
+    // by a CommandStack. It is created in the folder of GetTempPath on
+    // Windows and of $TMPDIR (/tmp by default) elsewhere, and removed
+    // by the system once closed. The ranges of released records are reused by
+    // later writes, so a spilled command which is kept for a long time
+    // doesn't make the file grow with every command spilled after it.
+    // The file is dropped once the last record has been released.
+    class CommandSpillFile
+    {
+    public:
+
+      CommandSpillFile();
+      ~CommandSpillFile();
+
+      // returns false if the temporary file can't be written,
+      // getError describes the reason then
+      bool write(const std::string & data, uint64_t & offset);
+      bool read(uint64_t offset, uint32_t length, std::string & data);
+      void release(uint64_t offset, uint32_t length);
+      const std::string & getError() const;
+
+    private:
+
+      // non copyable
+      CommandSpillFile(const CommandSpillFile & other);
+      CommandSpillFile & operator = (const CommandSpillFile & other);
+
+      bool open();
+      bool seek(uint64_t offset);
+      void close();
+
+      FILE * m_file;
+      uint64_t m_size;
+      uint32_t m_records;
+      // the released ranges before m_size, by offset
+      std::map<uint64_t, uint64_t> m_freeRanges;
+      std::string m_error;
+    };
+
+  };
+
+};
+
+#endif // __Commands_CommandSpillFile__
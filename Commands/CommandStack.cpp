@@ -3,20 +3,32 @@
 #include "CommandStack.h"
 
 #include <cstddef>
+#include <stdio.h>
 
 using namespace FabricServices::Commands;
+using namespace FabricServices::Threading;
 
 CommandStack::CommandStack()
 {
   m_limit = 0;
+  m_memoryBudget = 0;
+  m_memoryUsage = 0;
+  m_spillToDisk = false;
+  m_spilledUndoCount = 0;
+  m_mergeWindow = 0;
+  m_mergeTarget = NULL;
+  m_mergeTime = 0;
+  m_queue = NULL;
 }
 
 CommandStack::~CommandStack()
 {
-  for(size_t i=0;i<m_undoCommands.size();i++)
-    delete(m_undoCommands[i]);
-  for(size_t i=0;i<m_redoCommands.size();i++)
-    delete(m_redoCommands[i]);
+  setAsyncExecution(false);
+
+  for(uint32_t i=0;i<m_undoCommands.getCount();i++)
+    delete(m_undoCommands.get(i));
+  for(uint32_t i=0;i<m_redoCommands.getCount();i++)
+    delete(m_redoCommands.get(i));
 }
 
 uint32_t CommandStack::getLimit() const
@@ -28,47 +40,184 @@ void CommandStack::setLimit(uint32_t limit)
 {
   m_limit = limit;
 
-  capCommandsForLimit();
+  capCommandsForLimit(m_undoCommands);
+  capCommandsForLimit(m_redoCommands);
+
+  // with a limit the rings never have to grow again
+  if(m_limit > 0)
+  {
+    m_undoCommands.setCapacity(m_limit);
+    m_redoCommands.setCapacity(m_limit);
+  }
 }
 
-bool CommandStack::add(Command * command)
+uint64_t CommandStack::getMemoryBudget() const
 {
-  if(!command->invoke())
-    return false;
+  return m_memoryBudget;
+}
+
+void CommandStack::setMemoryBudget(uint64_t bytes)
+{
+  m_memoryBudget = bytes;
+  enforceMemoryBudget();
+}
+
+bool CommandStack::getSpillToDisk() const
+{
+  return m_spillToDisk;
+}
+
+void CommandStack::setSpillToDisk(bool state)
+{
+  // commands spilled already stay in the file until they are undone
+  m_spillToDisk = state;
+}
+
+const std::string & CommandStack::getSpillError() const
+{
+  return m_spillError;
+}
+
+uint64_t CommandStack::getMemoryUsage() const
+{
+  return m_memoryUsage;
+}
+
+uint32_t CommandStack::getMergeWindow() const
+{
+  return m_mergeWindow;
+}
+
+void CommandStack::setMergeWindow(uint32_t milliseconds)
+{
+  m_mergeWindow = milliseconds;
+  if(m_mergeWindow == 0)
+    m_mergeTarget = NULL;
+}
+
+void CommandStack::finishMerging()
+{
+  m_mergeTarget = NULL;
+}
+
+void CommandStack::setAsyncExecution(bool enabled)
+{
+  if(enabled == (m_queue != NULL))
+    return;
+  if(enabled)
+  {
+    m_queue = new CommandQueue();
+    return;
+  }
 
-  m_undoCommands.push_back(command);
+  waitForCommands();
+  delete(m_queue);
+  m_queue = NULL;
+}
 
-  for(size_t i=0;i<m_redoCommands.size();i++)
+bool CommandStack::isAsyncExecution() const
+{
+  return m_queue != NULL;
+}
+
+bool CommandStack::add(Command * command)
+{
+  if(m_queue)
   {
-    m_redoCommands[i]->destroy();
-    delete(m_redoCommands[i]);
+    m_queue->enqueue(command)->release();
+    return true;
   }
-  m_redoCommands.clear();
 
-  capCommandsForLimit();
+  if(!command->invoke())
+    return false;
 
+  pushInvokedCommand(command);
   return true;
 }
 
-void CommandStack::clear()
+CommandFuture * CommandStack::addAsync(Command * command, CommandQueue::Callback callback, void * userData)
+{
+  if(m_queue)
+    return m_queue->enqueue(command, callback, userData);
+
+  CommandFuture * future = new CommandFuture(command->getID());
+  bool succeeded = command->invoke();
+  if(callback)
+    (*callback)(command, succeeded, userData);
+  if(succeeded)
+    pushInvokedCommand(command);
+  else
+  {
+    command->destroy();
+    delete(command);
+  }
+  future->complete(succeeded);
+  return future;
+}
+
+uint32_t CommandStack::processInvokedCommands()
 {
-  for(size_t i=0;i<m_undoCommands.size();i++)
+  if(!m_queue)
+    return 0;
+
+  uint32_t result = 0;
+  Command * command;
+  bool succeeded;
+  while(m_queue->takeInvoked(command, succeeded))
   {
-    m_undoCommands[i]->destroy();
-    delete(m_undoCommands[i]);
+    if(succeeded)
+    {
+      pushInvokedCommand(command);
+      result++;
+    }
+    else
+    {
+      command->destroy();
+      delete(command);
+    }
   }
-  m_undoCommands.clear();
-  for(size_t i=0;i<m_redoCommands.size();i++)
+  return result;
+}
+
+void CommandStack::waitForCommands()
+{
+  if(!m_queue)
+    return;
+  m_queue->wait();
+  processInvokedCommands();
+}
+
+void CommandStack::pushInvokedCommand(Command * command)
+{
+  if(mergeCommand(command))
+    return;
+
+  command->m_stackMemoryUsage = command->getMemoryUsage();
+  m_memoryUsage += command->m_stackMemoryUsage;
+
+  pushWithinLimit(m_undoCommands, command);
+  destroyCommands(m_redoCommands);
+  enforceMemoryBudget();
+
+  if(m_mergeWindow > 0 && m_undoCommands.back() == command)
   {
-    m_redoCommands[i]->destroy();
-    delete(m_redoCommands[i]);
+    m_mergeTarget = command;
+    m_mergeTime = Thread::getMilliseconds();
   }
-  m_redoCommands.clear();
+}
+
+void CommandStack::clear()
+{
+  waitForCommands();
+  m_mergeTarget = NULL;
+  destroyCommands(m_undoCommands);
+  destroyCommands(m_redoCommands);
 }
 
 bool CommandStack::undo(unsigned int id)
 {
-  if(m_undoCommands.size() == 0)
+  waitForCommands();
+  if(m_undoCommands.isEmpty())
     return false;
 
   Command * command = m_undoCommands.back();
@@ -76,25 +225,38 @@ bool CommandStack::undo(unsigned int id)
   if(id != UINT_MAX && command->getID() != id)
     return false;
 
-  m_undoCommands.pop_back();
+  m_mergeTarget = NULL;
+
+  if(command->m_spilled && !restoreCommand(command))
+  {
+    // the history can't be undone past this command
+    printf("[CommandStack] Cannot restore spilled command '%s', dropping the undo history.\n", command->getName());
+    destroyCommands(m_undoCommands);
+    return false;
+  }
+
+  m_undoCommands.popBack();
+  if(m_spilledUndoCount > m_undoCommands.getCount())
+    m_spilledUndoCount = m_undoCommands.getCount();
 
   if(command->undo())
   {
-    m_redoCommands.push_back(command);
-    capCommandsForLimit();
+    updateMemoryUsage(command);
+    pushWithinLimit(m_redoCommands, command);
+    enforceMemoryBudget();
     return true;
   }
   else
   {
-    command->destroy();
-    delete(command);
+    destroyCommand(command);
   }
   return false;
 }
 
 bool CommandStack::redo(unsigned int id)
 {
-  if(m_redoCommands.size() == 0)
+  waitForCommands();
+  if(m_redoCommands.isEmpty())
     return false;
 
   Command * command = m_redoCommands.back();
@@ -102,45 +264,175 @@ bool CommandStack::redo(unsigned int id)
   if(id != UINT_MAX && command->getID() != id)
     return false;
 
-  m_redoCommands.pop_back();
+  m_mergeTarget = NULL;
+  m_redoCommands.popBack();
 
   if(command->redo())
   {
-    m_undoCommands.push_back(command);
-    capCommandsForLimit();
+    updateMemoryUsage(command);
+    pushWithinLimit(m_undoCommands, command);
+    enforceMemoryBudget();
     return true;
   }
   else
   {
-    command->destroy();
-    delete(command);
+    destroyCommand(command);
   }
 
   return false;
 }
 
-void CommandStack::capCommandsForLimit()
+void CommandStack::pushWithinLimit(CommandRing & commands, Command * command)
+{
+  if(m_limit > 0 && commands.getCount() >= m_limit)
+    destroyCommand(commands.popFront());
+  commands.pushBack(command);
+}
+
+void CommandStack::capCommandsForLimit(CommandRing & commands)
 {
   if(m_limit == 0)
     return;
 
-  if(m_undoCommands.size() > m_limit)
+  while(commands.getCount() > m_limit)
+    destroyCommand(commands.popFront());
+}
+
+void CommandStack::destroyCommands(CommandRing & commands)
+{
+  while(!commands.isEmpty())
+    destroyCommand(commands.popFront());
+}
+
+bool CommandStack::mergeCommand(Command * command)
+{
+  if(m_mergeTarget == NULL)
+    return false;
+
+  // the target might have been dropped or spilled since
+  Command * target = m_mergeTarget;
+  m_mergeTarget = NULL;
+  if(m_undoCommands.back() != target || target->m_spilled)
+    return false;
+
+  uint64_t now = Thread::getMilliseconds();
+  if(now - m_mergeTime > m_mergeWindow)
+    return false;
+  if(!target->canMergeWith(command) || !target->mergeWith(command))
+    return false;
+
+  // the other command lives on in the target
+  delete(command);
+
+  destroyCommands(m_redoCommands);
+  updateMemoryUsage(target);
+  enforceMemoryBudget();
+
+  // every merge extends the window
+  if(m_undoCommands.back() == target && !target->m_spilled)
   {
-    for(size_t i=0;i<m_undoCommands.size() - m_limit; i++)
-    {
-      m_undoCommands[i]->destroy();
-      delete(m_undoCommands[i]);
-    }
-    m_undoCommands = CommandVector(m_undoCommands.begin() + (m_undoCommands.size() - m_limit), m_undoCommands.end()); 
+    m_mergeTarget = target;
+    m_mergeTime = now;
+  }
+  return true;
+}
+
+void CommandStack::destroyCommand(Command * command)
+{
+  if(command == m_mergeTarget)
+    m_mergeTarget = NULL;
+
+  if(command->m_spilled)
+  {
+    m_spillFile.release(command->m_spillOffset, command->m_spillLength);
+    if(m_spilledUndoCount > 0)
+      m_spilledUndoCount--;
   }
+  else if(m_memoryUsage >= command->m_stackMemoryUsage)
+    m_memoryUsage -= command->m_stackMemoryUsage;
+  else
+    m_memoryUsage = 0;
+
+  command->destroy();
+  delete(command);
+}
+
+void CommandStack::updateMemoryUsage(Command * command)
+{
+  // undoing or redoing might change what the command holds on to
+  uint64_t memoryUsage = command->getMemoryUsage();
+  m_memoryUsage = m_memoryUsage - command->m_stackMemoryUsage + memoryUsage;
+  command->m_stackMemoryUsage = memoryUsage;
+}
+
+void CommandStack::enforceMemoryBudget()
+{
+  if(m_memoryBudget == 0)
+    return;
 
-  if(m_redoCommands.size() > m_limit)
+  while(m_memoryUsage > m_memoryBudget)
   {
-    for(size_t i=0;i<m_redoCommands.size() - m_limit; i++)
+    // the oldest undo command still in memory
+    if(m_spilledUndoCount < m_undoCommands.getCount())
+    {
+      Command * command = m_undoCommands.get(m_spilledUndoCount);
+      if(m_spillToDisk && spillCommand(command))
+      {
+        m_spilledUndoCount++;
+        continue;
+      }
+
+      // the history can't skip a command, so the
+      // spilled commands before it have to go as well
+      for(uint32_t i=m_spilledUndoCount+1;i>0;i--)
+        destroyCommand(m_undoCommands.popFront());
+      continue;
+    }
+
+    // the command undone first is the one least likely to be redone
+    if(!m_redoCommands.isEmpty())
     {
-      m_redoCommands[i]->destroy();
-      delete(m_redoCommands[i]);
+      destroyCommand(m_redoCommands.popFront());
+      continue;
     }
-    m_redoCommands = CommandVector(m_redoCommands.begin() + (m_redoCommands.size() - m_limit), m_redoCommands.end()); 
+
+    break;
+  }
+}
+
+bool CommandStack::spillCommand(Command * command)
+{
+  std::string data;
+  if(!command->spill(data))
+    return false;
+
+  uint64_t offset;
+  if(!m_spillFile.write(data, offset))
+  {
+    m_spillError = m_spillFile.getError();
+    command->restore(data);
+    return false;
   }
+  m_spillError.clear();
+
+  command->m_spilled = true;
+  command->m_spillOffset = offset;
+  command->m_spillLength = (uint32_t)data.length();
+  m_memoryUsage -= command->m_stackMemoryUsage;
+  return true;
+}
+
+bool CommandStack::restoreCommand(Command * command)
+{
+  std::string data;
+  if(!m_spillFile.read(command->m_spillOffset, command->m_spillLength, data))
+    return false;
+  if(!command->restore(data))
+    return false;
+
+  m_spillFile.release(command->m_spillOffset, command->m_spillLength);
+  command->m_spilled = false;
+  command->m_stackMemoryUsage = command->getMemoryUsage();
+  m_memoryUsage += command->m_stackMemoryUsage;
+  return true;
 }
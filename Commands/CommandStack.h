@@ -4,6 +4,9 @@
 #define __Commands_CommandStack__
 
 #include "Command.h"
+#include "CommandRing.h"
+#include "CommandSpillFile.h"
+#include "CommandQueue.h"
 
 #include <limits.h>
 #include <stdint.h>
@@ -24,6 +27,46 @@ namespace FabricServices
       uint32_t getLimit() const;
       void setLimit(uint32_t limit);
 
+      // the budget in bytes for the commands held in memory, 0 for none.
+      // the oldest commands are dropped first to stay within it. with
+      // spilling enabled undo commands supporting it are written to a
+      // temporary file instead, and read back once they are undone.
+      // redo commands are never spilled, once all undo commands are
+      // spilled or dropped the redo commands are dropped as well,
+      // starting with the one which would be redone last.
+      uint64_t getMemoryBudget() const;
+      void setMemoryBudget(uint64_t bytes);
+      bool getSpillToDisk() const;
+      void setSpillToDisk(bool state);
+      // the reason the last command couldn't be spilled, empty if it
+      // could. the command is dropped together with the ones before it.
+      const std::string & getSpillError() const;
+      // the memory used by the commands which aren't spilled
+      uint64_t getMemoryUsage() const;
+
+      // a command added within the merge window of the previous add is
+      // merged into the last command if that one accepts it, so a drag
+      // produces a single undo entry. 0 disables merging. finishMerging
+      // closes the window early, for example when the mouse is released.
+      uint32_t getMergeWindow() const;
+      void setMergeWindow(uint32_t milliseconds);
+      void finishMerging();
+
+      // in asynchronous mode add queues the command and returns right
+      // away, the commands are invoked in order on a worker thread. the
+      // invoked commands are pushed onto the undo stack by
+      // processInvokedCommands, which the owner has to call regularly,
+      // and by undo, redo and clear, which wait for the queue first.
+      // the stack owns queued commands, failed ones are deleted.
+      void setAsyncExecution(bool enabled);
+      bool isAsyncExecution() const;
+      // queues the command, or invokes it right away if not in asynchronous
+      // mode. the returned future has to be released by the caller.
+      CommandFuture * addAsync(Command * command, CommandQueue::Callback callback = 0, void * userData = 0);
+      // returns the number of commands pushed onto the undo stack
+      uint32_t processInvokedCommands();
+      void waitForCommands();
+
       virtual bool add(Command * command);
       virtual void clear();
       virtual bool undo(unsigned int id = UINT_MAX);
@@ -31,11 +74,37 @@ namespace FabricServices
 
     private:
 
-      void capCommandsForLimit();
+      void pushInvokedCommand(Command * command);
+      // drops the oldest command of the ring if it is at the limit
+      void pushWithinLimit(CommandRing & commands, Command * command);
+      void capCommandsForLimit(CommandRing & commands);
+      void destroyCommands(CommandRing & commands);
+      void destroyCommand(Command * command);
+
+      void updateMemoryUsage(Command * command);
+      void enforceMemoryBudget();
+      bool spillCommand(Command * command);
+      bool restoreCommand(Command * command);
+      bool mergeCommand(Command * command);
 
       uint32_t m_limit;
-      CommandVector m_undoCommands;
-      CommandVector m_redoCommands;
+      CommandRing m_undoCommands;
+      CommandRing m_redoCommands;
+
+      uint64_t m_memoryBudget;
+      uint64_t m_memoryUsage;
+      bool m_spillToDisk;
+      // the spilled commands are always the oldest ones of the undo stack
+      uint32_t m_spilledUndoCount;
+      CommandSpillFile m_spillFile;
+      std::string m_spillError;
+
+      uint32_t m_mergeWindow;
+      // the command added last and when, as long as it is on top of the undo stack
+      Command * m_mergeTarget;
+      uint64_t m_mergeTime;
+
+      CommandQueue * m_queue;
     };
 
   };
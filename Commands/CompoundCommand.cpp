@@ -3,12 +3,13 @@
 #include "CompoundCommand.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 using namespace FabricServices::Commands;
 
 CompoundCommand::CompoundCommand()
 {
-
+  m_invokedCount = 0;
 }
 
 CompoundCommand::~CompoundCommand()
@@ -19,12 +20,25 @@ CompoundCommand::~CompoundCommand()
 
 bool CompoundCommand::add(Command * command)
 {
+  // keep the order if there are deferred commands already
+  if(m_invokedCount < m_commands.size())
+  {
+    addDeferred(command);
+    return true;
+  }
+
   if(!command->invoke())
     return false;
   m_commands.push_back(command);
+  m_invokedCount = m_commands.size();
   return true;
 }
 
+void CompoundCommand::addDeferred(Command * command)
+{
+  m_commands.push_back(command);
+}
+
 bool CompoundCommand::isEmpty() const
 {
   return m_commands.size() == 0;
@@ -32,7 +46,19 @@ bool CompoundCommand::isEmpty() const
 
 bool CompoundCommand::invoke()
 {
-  // we have already invoked our child commands on addCommand
+  // the commands added through add have been invoked already
+  for(size_t i=m_invokedCount;i<m_commands.size();i++)
+  {
+    if(m_commands[i]->invoke())
+      continue;
+
+    // only the deferred commands are rolled back, the ones
+    // added through add belong to the caller's own state
+    for(size_t j=i;j>m_invokedCount;j--)
+      m_commands[j-1]->undo();
+    return false;
+  }
+  m_invokedCount = m_commands.size();
   return true;
 }
 
@@ -62,6 +88,60 @@ void CompoundCommand::destroy()
     m_commands[i]->destroy();
 } 
 
+uint64_t CompoundCommand::getMemoryUsage() const
+{
+  uint64_t result = 0;
+  for(size_t i=0;i<m_commands.size();i++)
+    result += m_commands[i]->getMemoryUsage();
+  return result;
+}
+
+bool CompoundCommand::spill(std::string & data)
+{
+  // the states of the child commands, each prefixed by its length
+  std::string childData;
+  for(size_t i=0;i<m_commands.size();i++)
+  {
+    childData.clear();
+    if(!m_commands[i]->spill(childData))
+    {
+      // bring back the ones spilled already
+      std::string spilled;
+      spilled.swap(data);
+      restoreChildren(spilled, i);
+      return false;
+    }
+    uint32_t length = (uint32_t)childData.length();
+    data.append((const char *)&length, sizeof(uint32_t));
+    data.append(childData);
+  }
+  return true;
+}
+
+bool CompoundCommand::restore(const std::string & data)
+{
+  return restoreChildren(data, m_commands.size());
+}
+
+bool CompoundCommand::restoreChildren(const std::string & data, size_t count)
+{
+  size_t offset = 0;
+  for(size_t i=0;i<count;i++)
+  {
+    uint32_t length;
+    if(offset + sizeof(uint32_t) > data.length())
+      return false;
+    memcpy(&length, data.c_str() + offset, sizeof(uint32_t));
+    offset += sizeof(uint32_t);
+    if(offset + length > data.length())
+      return false;
+    if(!m_commands[i]->restore(data.substr(offset, length)))
+      return false;
+    offset += length;
+  }
+  return true;
+}
+
 unsigned int CompoundCommand::getNbCommands() const
 {
   return (unsigned int)m_commands.size();
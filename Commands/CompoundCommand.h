@@ -22,6 +22,11 @@ namespace FabricServices
       virtual const char * getFullDesc() const { return "A command to contain other commands."; }
 
       virtual bool add(Command * command);
+      // adds the command without invoking it, the deferred commands are
+      // invoked in order when the compound is, for example as a single
+      // item of a CommandQueue. if one of them fails the deferred
+      // commands invoked so far are undone again and the compound fails.
+      virtual void addDeferred(Command * command);
       virtual bool isEmpty() const;
 
       unsigned int getNbCommands() const;
@@ -30,6 +35,8 @@ namespace FabricServices
       Command * getFirstNonCompoundCommand();
       Command * getLastNonCompoundCommand();
 
+      virtual uint64_t getMemoryUsage() const;
+
     protected:
       
       virtual bool invoke();
@@ -37,9 +44,17 @@ namespace FabricServices
       virtual bool redo();
       virtual void destroy(); 
 
+      // only spills if all of the child commands can be spilled
+      virtual bool spill(std::string & data);
+      virtual bool restore(const std::string & data);
+
     private:
 
+      bool restoreChildren(const std::string & data, size_t count);
+
       CommandVector m_commands;
+      // the leading commands which have been invoked
+      size_t m_invokedCount;
     };
 
   };
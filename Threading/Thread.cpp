@@ -0,0 +1,246 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#include "Thread.h"
+
+#if defined(_WIN32)
+# include <windows.h>
+# include <process.h>
+#else
+# include <pthread.h>
+# include <unistd.h>
+# include <errno.h>
+# include <sys/time.h>
+# include <time.h>
+#endif
+
+using namespace FabricServices::Threading;
+
+#if defined(_WIN32)
+
+Mutex::Mutex()
+{
+  CRITICAL_SECTION * cs = new CRITICAL_SECTION;
+  InitializeCriticalSection(cs);
+  m_handle = cs;
+}
+
+Mutex::~Mutex()
+{
+  CRITICAL_SECTION * cs = (CRITICAL_SECTION *)m_handle;
+  DeleteCriticalSection(cs);
+  delete(cs);
+}
+
+void Mutex::lock()
+{
+  EnterCriticalSection((CRITICAL_SECTION *)m_handle);
+}
+
+void Mutex::unlock()
+{
+  LeaveCriticalSection((CRITICAL_SECTION *)m_handle);
+}
+
+Condition::Condition()
+{
+  CONDITION_VARIABLE * cv = new CONDITION_VARIABLE;
+  InitializeConditionVariable(cv);
+  m_handle = cv;
+}
+
+Condition::~Condition()
+{
+  delete((CONDITION_VARIABLE *)m_handle);
+}
+
+void Condition::wait(Mutex & mutex)
+{
+  SleepConditionVariableCS((CONDITION_VARIABLE *)m_handle, (CRITICAL_SECTION *)mutex.m_handle, INFINITE);
+}
+
+bool Condition::wait(Mutex & mutex, uint32_t milliseconds)
+{
+  return SleepConditionVariableCS((CONDITION_VARIABLE *)m_handle, (CRITICAL_SECTION *)mutex.m_handle, milliseconds) != 0;
+}
+
+void Condition::wakeOne()
+{
+  WakeConditionVariable((CONDITION_VARIABLE *)m_handle);
+}
+
+void Condition::wakeAll()
+{
+  WakeAllConditionVariable((CONDITION_VARIABLE *)m_handle);
+}
+
+static unsigned __stdcall ThreadEntry(void * thread)
+{
+  Thread::entry(thread);
+  return 0;
+}
+
+#else
+
+Mutex::Mutex()
+{
+  pthread_mutex_t * mutex = new pthread_mutex_t;
+  pthread_mutex_init(mutex, NULL);
+  m_handle = mutex;
+}
+
+Mutex::~Mutex()
+{
+  pthread_mutex_t * mutex = (pthread_mutex_t *)m_handle;
+  pthread_mutex_destroy(mutex);
+  delete(mutex);
+}
+
+void Mutex::lock()
+{
+  pthread_mutex_lock((pthread_mutex_t *)m_handle);
+}
+
+void Mutex::unlock()
+{
+  pthread_mutex_unlock((pthread_mutex_t *)m_handle);
+}
+
+Condition::Condition()
+{
+  pthread_cond_t * cond = new pthread_cond_t;
+  pthread_cond_init(cond, NULL);
+  m_handle = cond;
+}
+
+Condition::~Condition()
+{
+  pthread_cond_t * cond = (pthread_cond_t *)m_handle;
+  pthread_cond_destroy(cond);
+  delete(cond);
+}
+
+void Condition::wait(Mutex & mutex)
+{
+  pthread_cond_wait((pthread_cond_t *)m_handle, (pthread_mutex_t *)mutex.m_handle);
+}
+
+bool Condition::wait(Mutex & mutex, uint32_t milliseconds)
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  uint64_t nsec = (uint64_t)now.tv_usec * 1000 + (uint64_t)(milliseconds % 1000) * 1000000;
+  struct timespec deadline;
+  deadline.tv_sec = now.tv_sec + milliseconds / 1000 + (time_t)(nsec / 1000000000);
+  deadline.tv_nsec = (long)(nsec % 1000000000);
+
+  return pthread_cond_timedwait((pthread_cond_t *)m_handle, (pthread_mutex_t *)mutex.m_handle, &deadline) != ETIMEDOUT;
+}
+
+void Condition::wakeOne()
+{
+  pthread_cond_signal((pthread_cond_t *)m_handle);
+}
+
+void Condition::wakeAll()
+{
+  pthread_cond_broadcast((pthread_cond_t *)m_handle);
+}
+
+#endif
+
+Thread::Thread()
+{
+  m_handle = NULL;
+  m_running = false;
+}
+
+Thread::~Thread()
+{
+  join();
+}
+
+bool Thread::start()
+{
+  if(m_running)
+    return false;
+
+#if defined(_WIN32)
+  uintptr_t handle = _beginthreadex(NULL, 0, &ThreadEntry, this, 0, NULL);
+  if(handle == 0)
+    return false;
+  m_handle = (void *)handle;
+#else
+  pthread_t * thread = new pthread_t;
+  if(pthread_create(thread, NULL, &Thread::entry, this) != 0)
+  {
+    delete(thread);
+    return false;
+  }
+  m_handle = thread;
+#endif
+
+  m_running = true;
+  return true;
+}
+
+void Thread::join()
+{
+  if(!m_running)
+    return;
+
+#if defined(_WIN32)
+  WaitForSingleObject((HANDLE)m_handle, INFINITE);
+  CloseHandle((HANDLE)m_handle);
+#else
+  pthread_t * thread = (pthread_t *)m_handle;
+  pthread_join(*thread, NULL);
+  delete(thread);
+#endif
+
+  m_handle = NULL;
+  m_running = false;
+}
+
+bool Thread::isRunning() const
+{
+  return m_running;
+}
+
+uint32_t Thread::getHardwareConcurrency()
+{
+#if defined(_WIN32)
+  SYSTEM_INFO systemInfo;
+  GetSystemInfo(&systemInfo);
+  return systemInfo.dwNumberOfProcessors > 0 ? (uint32_t)systemInfo.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+void Thread::sleep(uint32_t milliseconds)
+{
+#if defined(_WIN32)
+  Sleep(milliseconds);
+#else
+  usleep((useconds_t)milliseconds * 1000);
+#endif
+}
+
+uint64_t Thread::getMilliseconds()
+{
+#if defined(_WIN32)
+  return (uint64_t)GetTickCount64();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+#endif
+}
+
+void * Thread::entry(void * thread)
+{
+  ((Thread *)thread)->run();
+  return NULL;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2010-2017 Fabric Software Inc. All rights reserved.
+
+#ifndef __Threading_Thread__
+#define __Threading_Thread__
+
+#include <stdint.h>
+
+namespace FabricServices
+{
+
+  namespace Threading
+  {
+    class Condition;
+
+    // A thin wrapper around the platform mutex (pthreads or win32).
+    class Mutex
+    {
+      friend class Condition;
+
+    public:
+
+      Mutex();
+      ~Mutex();
+
+      void lock();
+      void unlock();
+
+    private:
+
+      // non copyable
+      Mutex(const Mutex & other);
+      Mutex & operator = (const Mutex & other);
+
+      void * m_handle;
+    };
+
+    // Locks a mutex for the lifetime of the scope.
+    class MutexLocker
+    {
+    public:
+
+      MutexLocker(Mutex & mutex) : m_mutex(mutex) { m_mutex.lock(); }
+      ~MutexLocker() { m_mutex.unlock(); }
+
+    private:
+
+      MutexLocker(const MutexLocker & other);
+      MutexLocker & operator = (const MutexLocker & other);
+
+      Mutex & m_mutex;
+    };
+
+    // A condition variable to be used together with a Mutex.
+    class Condition
+    {
+    public:
+
+      Condition();
+      ~Condition();
+
+      // the mutex has to be locked by the caller
+      void wait(Mutex & mutex);
+      // returns false if the timeout elapsed without a wake up
+      bool wait(Mutex & mutex, uint32_t milliseconds);
+      void wakeOne();
+      void wakeAll();
+
+    private:
+
+      Condition(const Condition & other);
+      Condition & operator = (const Condition & other);
+
+      void * m_handle;
+    };
+
+    // A joinable thread running the virtual run() method.
+    // The thread has to be joined before the object is destroyed.
+    class Thread
+    {
+    public:
+
+      Thread();
+      virtual ~Thread();
+
+      bool start();
+      void join();
+      bool isRunning() const;
+
+      static uint32_t getHardwareConcurrency();
+      static void sleep(uint32_t milliseconds);
+      // a monotonic clock for timeouts and debouncing
+      static uint64_t getMilliseconds();
+
+      // platform entry point, not to be called directly
+      static void * entry(void * thread);
+
+    protected:
+
+      virtual void run() = 0;
+
+    private:
+
+      Thread(const Thread & other);
+      Thread & operator = (const Thread & other);
+
+      void * m_handle;
+      bool m_running;
+    };
+
+  };
+
+};
+
+#endif // __Threading_Thread__